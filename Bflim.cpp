@@ -1,11 +1,31 @@
 #include <Bflim.h>
 #include <BflimFormats.h>
 #include <BinaryUtils.h>
-#include <iostream>
 #include <algorithm>
 #include <ninTexUtils/gx2/gx2Surface.h>
 #include <memory>
-#include <ninTexUtils/bcn/decompress.h>
+#include <BflimDecoders.h>
+#include <BflimEncoders.h>
+#include <BflimCtr.h>
+#include <BflimTiling.h>
+#include <BflimSimd.h>
+#include <BflimLog.h>
+#include <BflimProfiler.h>
+#include <BflimColor.h>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+    std::string hexString(u32 value)
+    {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%X", value);
+        return buffer;
+    }
+}
 
 bool Bflim::isValid(const std::vector<u8>& data)
 {
@@ -21,77 +41,70 @@ bool Bflim::isValid(const std::vector<u8>& data)
 
 
 void Bflim::parseBinary(const std::vector<u8>& data) {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Parse, data.size());
     
     if (!isValid(data)) {
         return;
     }
     
     mRawData = data;
+    BflimProfiler::countAllocation(data.size());
     
     parseImageInformation(data);
     
     size_t headerSize = 0x28; 
-    if (data.size() > headerSize)
-    {
-        size_t imageDataSize = data.size() - headerSize;
-        mImageData.assign(data.begin(), data.begin() + imageDataSize);
-    }
+    mImageDataSize = data.size() > headerSize ? data.size() - headerSize : 0;
 }
 
 void Bflim::parseImageInformation(const std::vector<u8>& data) {
-    if (data.size() < 0x28) {
+    BflimView view;
+    if (!view.parse(data.data(), data.size())) {
         return;
     }
-    
-    size_t imagOffset = data.size() - 0x28;
-    
-    for (size_t i = data.size() - 0x50; i < data.size() - 0x10; i++) {
-        if (data[i] == 'i' && data[i+1] == 'm' && 
-            data[i+2] == 'a' && data[i+3] == 'g') {
-            imagOffset = i;
-            break;
-        }
-    }
-    
-    mImageWidth = Read16(&data[imagOffset + 0x08]);
-    mImageHeight = Read16(&data[imagOffset + 0x0A]);
 
-    u16 FormatID = data[imagOffset + 0x0E];
+    parseImageInformation(view);
+}
+
+void Bflim::parseImageInformation(const BflimView& view) {
+    mImageWidth = view.getImageWidth();
+    mImageHeight = view.getImageHeight();
+    mPlatform = view.getPlatform();
 
-    for(u32 i=0; i<BflimConstants::SupportedFormats.size(); i++)
+    if (view.getImageFormat())
     {
-        if(BflimConstants::SupportedFormats[i].mId == FormatID)
-        {
-            mImageFormat = BflimConstants::SupportedFormats[i];
-            break;
-        }
+        mImageFormat = *view.getImageFormat();
+    }
+    else
+    {
+        mImageFormat = Format();
+        mImageFormat.mId = view.getFormatId();
     }
 
-    u8 tileModeSwizzle = data[imagOffset + 0x0F];
-    mTileMode = tileModeSwizzle & 0x1F;
-    mSwizzle = (tileModeSwizzle >> 5) & 0x07;
+    mTileMode = view.getTileMode();
+    mSwizzle = view.getSwizzle();
 
-    mPipeSwizzle = (mSwizzle >> 0) & 0x01;  
-    mBankSwizzle = (mSwizzle >> 1) & 0x03;  
+    mPipeSwizzle = view.getPipeSwizzle();  
+    mBankSwizzle = view.getBankSwizzle();  
 }
 
-std::vector<u8> Bflim::deswizzleLinear(const std::vector<u8>& data , u32 Bpp)
+std::vector<u8> Bflim::deswizzleLinear(const std::vector<u8>& data , u32 Bpp) const
 {
-    u16 pitch;
-    u32 bytesPerPixel = Bpp / 8;
+    return deswizzleLinear(data.data(), data.size(), Bpp);
+}
 
-    if(mTileMode == 0)
-    {
-        pitch = mImageWidth;
-    }
-    else if(mTileMode ==1)
-    {
-        u32 pitchAlign = std::max(64u, 2048u / Bpp);
-        pitch = alignTo(mImageWidth * bytesPerPixel, pitchAlign) / bytesPerPixel;
-    }
+std::vector<u8> Bflim::deswizzleLinear(const u8* data, size_t size, u32 Bpp) const
+{
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Deswizzle, size);
+    u32 pitch = getLinearPitch(Bpp);
+    u32 bytesPerPixel = Bpp / 8;
 
     u32 vectorSize = mImageWidth * mImageHeight * bytesPerPixel;
+    if (size < getLinearSurfaceSize(Bpp)) {
+        BFLIM_LOG(BflimLog::Level::Error, "Image data smaller than surface size!");
+        return std::vector<u8>();
+    }
     std::vector<u8> newData(vectorSize);
+    BflimProfiler::countAllocation(vectorSize);
 
     for(u16 y=0; y < mImageHeight; y++)
     {
@@ -106,12 +119,42 @@ std::vector<u8> Bflim::deswizzleLinear(const std::vector<u8>& data , u32 Bpp)
     return newData;
 }
 
-std::vector<u8> Bflim::deswizzleMacroTiled(const std::vector<u8>& data, u32 Bpp) {
-    
+u32 Bflim::getLinearPitch(u32 Bpp) const
+{
+    u32 pitch = mImageWidth;
+    u32 bytesPerPixel = Bpp / 8;
+
+    if(mTileMode ==1 && bytesPerPixel > 0)
+    {
+        // LINEAR_ALIGNED pitch alignment in elements (AddrLib: 64 or one 256-byte group)
+        u32 pitchAlign = std::max(64u, 256u / bytesPerPixel);
+        pitch = alignTo(mImageWidth, pitchAlign);
+    }
+    return pitch;
+}
+
+size_t Bflim::getLinearSurfaceSize(u32 Bpp) const
+{
+    if (mImageHeight == 0) return 0;
+    return ((size_t)(mImageHeight - 1) * getLinearPitch(Bpp) + mImageWidth) * (Bpp / 8);
+}
+
+std::vector<u8> Bflim::deswizzleMacroTiled(const std::vector<u8>& data, u32 Bpp) const {
+    return deswizzleMacroTiled(data.data(), data.size(), Bpp);
+}
+
+std::vector<u8> Bflim::deswizzleMacroTiled(const u8* data, size_t size, u32 Bpp) const {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Deswizzle, size);
+
+#ifdef BFLIM_GX2_REFERENCE_TILING
     // Source Surface (geswizzelt)
     GX2Surface srcSurf = createGX2Surface();
     GX2CalcSurfaceSizeAndAlignment(&srcSurf);
-    srcSurf.imagePtr.set(const_cast<u8*>(data.data()));
+    if (size < srcSurf.imageSize) {
+        BFLIM_LOG(BflimLog::Level::Error, "Image data smaller than surface size!");
+        return std::vector<u8>();
+    }
+    srcSurf.imagePtr.set(const_cast<u8*>(data));
     
     // Dest Surface (linear)
     GX2Surface dstSurf;
@@ -137,47 +180,50 @@ std::vector<u8> Bflim::deswizzleMacroTiled(const std::vector<u8>& data, u32 Bpp)
     GX2CopySurface(&srcSurf, 0, 0, &dstSurf, 0, 0);
     
     return output;
+#else
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    if (size < tileMap->getImageSize()) {
+        BFLIM_LOG(BflimLog::Level::Error, "Image data smaller than surface size!");
+        return std::vector<u8>();
+    }
+
+    std::vector<u8> output(tileMap->getLinearSize());
+    BflimProfiler::countAllocation(output.size());
+    tileMap->deswizzle(data, output.data());
+    return output;
+#endif
 }
 
 GX2SurfaceFormat Bflim::bflimFormatToGX2(u8 bflimFormat) const {
-    switch (bflimFormat) {
-        case 0x00: return GX2_SURFACE_FORMAT_UNORM_R8;      // L8
-        case 0x01: return GX2_SURFACE_FORMAT_UNORM_R8;      // A8
-        case 0x03: return GX2_SURFACE_FORMAT_UNORM_RG8;     // LA8
-        case 0x05: return GX2_SURFACE_FORMAT_UNORM_RGB565;  // RGB565
-        case 0x07: return GX2_SURFACE_FORMAT_UNORM_RGB5A1;  // RGB5A1
-        case 0x08: return GX2_SURFACE_FORMAT_UNORM_RGBA4;   // RGBA4
-        case 0x09: return GX2_SURFACE_FORMAT_UNORM_RGBA8;   // RGBA8
-        case 0x0C: return GX2_SURFACE_FORMAT_UNORM_BC1;     // BC1
-        case 0x0D: return GX2_SURFACE_FORMAT_UNORM_BC2;     // BC2
-        case 0x0E: return GX2_SURFACE_FORMAT_UNORM_BC3;     // BC3
-        case 0x0F: return GX2_SURFACE_FORMAT_UNORM_BC4;     // BC4L
-        case 0x10: return GX2_SURFACE_FORMAT_UNORM_BC4;     // BC4A
-        case 0x11: return GX2_SURFACE_FORMAT_UNORM_BC5;     // BC5
-        case 0x14: return GX2_SURFACE_FORMAT_SRGB_RGBA8;    // RGBA8 sRGB
-        case 0x15: return GX2_SURFACE_FORMAT_SRGB_BC1;      // BC1 sRGB
-        case 0x16: return GX2_SURFACE_FORMAT_SRGB_BC2;      // BC2 sRGB
-        case 0x17: return GX2_SURFACE_FORMAT_SRGB_BC3;      // BC3 sRGB
-        default:   return GX2_SURFACE_FORMAT_UNORM_RGBA8;
+    const Format* format = BflimConstants::findFormat(bflimFormat);
+    if (!format || format->mGX2Format == GX2_SURFACE_FORMAT_INVALID) {
+        return GX2_SURFACE_FORMAT_UNORM_RGBA8;
     }
+    return format->mGX2Format;
 }
 
 GX2Surface Bflim::createGX2Surface() const {
+    return createGX2Surface(mImageWidth, mImageHeight, mImageFormat.mId, mTileMode, mSwizzle);
+}
+
+GX2Surface Bflim::createGX2Surface(u16 width, u16 height, u8 formatId, u8 tileMode, u8 swizzle) {
+    const Format* format = BflimConstants::findFormat(formatId);
     GX2Surface surf;
     std::memset(&surf, 0, sizeof(GX2Surface));
     
     surf.dim = GX2_SURFACE_DIM_2D;
-    surf.width = mImageWidth;
-    surf.height = mImageHeight;
+    surf.width = width;
+    surf.height = height;
     surf.depth = 1;
     surf.numMips = 1;
-    surf.format = bflimFormatToGX2(mImageFormat.mId); 
+    surf.format = (format && format->mGX2Format != GX2_SURFACE_FORMAT_INVALID) ? format->mGX2Format
+                                                                              : GX2_SURFACE_FORMAT_UNORM_RGBA8;
     surf.aa = GX2_AA_MODE_1X;
     surf.use = GX2_SURFACE_USE_TEXTURE;
-    surf.tileMode = (GX2TileMode)(mTileMode); 
+    surf.tileMode = (GX2TileMode)(tileMode); 
     
-    u8 pipeSwizzle = (mSwizzle >> 0) & 0x01;
-    u8 bankSwizzle = (mSwizzle >> 1) & 0x03;
+    u8 pipeSwizzle = (swizzle >> 0) & 0x01;
+    u8 bankSwizzle = (swizzle >> 1) & 0x03;
     surf.swizzle = ((bankSwizzle << 1) | pipeSwizzle) << 8;
     surf.swizzle |= 0xD0000;  
 
@@ -186,152 +232,791 @@ GX2Surface Bflim::createGX2Surface() const {
     return surf;
 }
 
-std::vector<u8> Bflim::decodeRGBA8(const std::vector<u8>& data) {
-    std::vector<u8> output(data.size());
-    
-    for (size_t i = 0; i < data.size(); i += 4) {
-        u32 pixel = Read32(&data[i]);
-        
-        output[i + 0] = (pixel >> 24) & 0xFF;  // R
-        output[i + 1] = (pixel >> 16) & 0xFF;  // G
-        output[i + 2] = (pixel >> 8) & 0xFF;   // B
-        output[i + 3] = pixel & 0xFF;           // A
-    }
-    
+std::vector<u8> Bflim::decodeRGBA8(const std::vector<u8>& data) const {
+    std::vector<u8> output(data.size() / 4 * 4);
+    BflimDecoders::get(0x09)(data.data(), output.data(), data.size() / 4, 1);
     return output;
 }
 
-std::vector<u8> Bflim::decodeBC1(const std::vector<u8>& data) {
+std::vector<u8> Bflim::decodeBC1(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    BCn_DecompressBC1(mImageWidth, mImageHeight, data.data(), output.data());
+    BflimDecoders::get(0x0C)(data.data(), output.data(), mImageWidth, mImageHeight);
     return output;
 }
 
-std::vector<u8> Bflim::decodeBC2(const std::vector<u8>& data) {
+std::vector<u8> Bflim::decodeBC2(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    BCn_DecompressBC2(mImageWidth, mImageHeight, data.data(), output.data());
+    BflimDecoders::get(0x0D)(data.data(), output.data(), mImageWidth, mImageHeight);
     return output;
 }
 
-std::vector<u8> Bflim::decodeBC3(const std::vector<u8>& data) {
+std::vector<u8> Bflim::decodeBC3(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    BCn_DecompressBC3(mImageWidth, mImageHeight, data.data(), output.data());
+    BflimDecoders::get(0x0E)(data.data(), output.data(), mImageWidth, mImageHeight);
     return output;
 }
 
-std::vector<u8> Bflim::decodeBC4L(const std::vector<u8>& data) {
+std::vector<u8> Bflim::decodeBC4L(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    BCn_DecompressBC4U(mImageWidth, mImageHeight, data.data(), output.data());
-    
-    for (size_t i = 0; i < mImageWidth * mImageHeight; i++) {
-        u8 r = output[i * 4 + 0];
-        output[i * 4 + 0] = r;  // R
-        output[i * 4 + 1] = r;  // G = R
-        output[i * 4 + 2] = r;  // B = R
-        output[i * 4 + 3] = 255; // A = voll
-    }
+    BflimDecoders::get(0x0F)(data.data(), output.data(), mImageWidth, mImageHeight);
     return output;
 }
 
-std::vector<u8> Bflim::decodeBC4A(const std::vector<u8>& data) {
-    std::vector<u8> raw(mImageWidth * mImageHeight * 4);
-    BCn_DecompressBC4U(mImageWidth, mImageHeight, data.data(), raw.data());
-    
+std::vector<u8> Bflim::decodeBC4A(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    for (size_t i = 0; i < mImageWidth * mImageHeight; i++) {
-        u8 r = raw[i * 4 + 0];  // Alpha-Wert
-        output[i * 4 + 0] = r;  // R = Alpha
-        output[i * 4 + 1] = r;  // G = Alpha
-        output[i * 4 + 2] = r;  // B = Alpha
-        output[i * 4 + 3] = 255; // A = voll sichtbar
-    }
+    BflimDecoders::get(0x10)(data.data(), output.data(), mImageWidth, mImageHeight);
     return output;
 }
 
-std::vector<u8> Bflim::decodeBC5(const std::vector<u8>& data) {
-    std::vector<u8> raw(mImageWidth * mImageHeight * 4);
-    BCn_DecompressBC5U(mImageWidth, mImageHeight, data.data(), raw.data());
-
-    std::cout << "BC5 Pixel 0: R=" << (int)raw[0] 
-              << " G=" << (int)raw[1]
-              << " B=" << (int)raw[2]
-              << " A=" << (int)raw[3] << std::endl;
-    
+std::vector<u8> Bflim::decodeBC5(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    for (size_t i = 0; i < mImageWidth * mImageHeight; i++) {
-        u8 r = raw[i * 4 + 0];
-        u8 g = raw[i * 4 + 1];
-        output[i * 4 + 0] = r;
-        output[i * 4 + 1] = r;   // Grau = R
-        output[i * 4 + 2] = r;
-        output[i * 4 + 3] = 255;
-    }
+    BflimDecoders::get(0x11)(data.data(), output.data(), mImageWidth, mImageHeight);
+
     return output;
 }
 
-std::vector<u8> Bflim::decodeL8(const std::vector<u8>& data) {
+std::vector<u8> Bflim::decodeL8(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    for (size_t i = 0; i < mImageWidth * mImageHeight; i++) {
-        u8 l = data[i];         // Ein Byte pro Pixel!
-        output[i * 4 + 0] = l; // R
-        output[i * 4 + 1] = l; // G
-        output[i * 4 + 2] = l; // B
-        output[i * 4 + 3] = 255;// A
-    }
+    BflimDecoders::get(0x00)(data.data(), output.data(), mImageWidth, mImageHeight);
     return output;
 }
 
-std::vector<u8> Bflim::decodeLA8(const std::vector<u8>& data) {
+std::vector<u8> Bflim::decodeLA8(const std::vector<u8>& data) const {
     std::vector<u8> output(mImageWidth * mImageHeight * 4);
-    for (size_t i = 0; i < mImageWidth * mImageHeight; i++) {
-        u8 l = data[i * 2 + 0]; // Luminance
-        u8 a = data[i * 2 + 1]; // Alpha
-        output[i * 4 + 0] = l;  // R
-        output[i * 4 + 1] = l;  // G
-        output[i * 4 + 2] = l;  // B
-        output[i * 4 + 3] = a;  // A
+    BflimDecoders::get(0x03)(data.data(), output.data(), mImageWidth, mImageHeight);
+    return output;
+}
+
+bool Bflim::isDecodable() const {
+    if (mPlatform == BflimPlatform::CTR) {
+        // mBPP is 0 when the 3DS format byte was not recognised
+        return mImageFormat.mBPP != 0 && BflimCtr::isDecodable(mImageFormat.mId);
+    }
+
+    // ETC1, L4 and A4 have no GX2 surface format to deswizzle with
+    return BflimDecoders::get(mImageFormat.mId) && mImageFormat.mGX2Format != GX2_SURFACE_FORMAT_INVALID;
+}
+
+void Bflim::decodeLinearTo(const u8* linear, u8* output, u32 width, u32 height, u8* rgba,
+                           const BflimDecodeOptions& options) const {
+    const BflimPixelFormat format = options.pixelFormat;
+    if (getConversionScratchSize(1, options) == 0) {
+        // Same size per pixel, converted in place
+        rgba = output;
+    }
+
+    decodeLinear(linear, rgba, width, height);
+    BflimColor::convert(rgba, output, (size_t)width * height, format, BflimColor::isSrgbFormat(mImageFormat.mId));
+}
+
+size_t Bflim::getConversionScratchSize(size_t pixels, const BflimDecodeOptions& options) const {
+    return BflimColor::getBytesPerPixel(options.pixelFormat) == 4 ? 0 : pixels * 4;
+}
+
+bool Bflim::decodeLinear(const u8* linear, u8* output, u32 width, u32 height) const {
+    BflimDecoders::Kernel kernel = BflimDecoders::get(mImageFormat.mId);
+    if (!kernel) {
+        return false;
+    }
+
+    kernel(linear, output, width, height);
+    return true;
+}
+
+std::vector<u8> Bflim::getDeswizzledRGBA(const std::vector<u8>& data) const {
+    return getDeswizzledRGBA(data.data(), data.size());
+}
+
+std::vector<u8> Bflim::getDeswizzledRGBA(const u8* data, size_t size) const {
+    std::vector<u8> output;
+    std::string error;
+    if (!decodeRGBA(data, size, output, error)) {
+        BFLIM_LOG(BflimLog::Level::Error, error);
+        return std::vector<u8>(getDecodedSize(), 128);
     }
     return output;
 }
 
-std::vector<u8> Bflim::getDeswizzledRGBA(const std::vector<u8>& data) {
-    
-    std::vector<u8> linear;
-    
-   
-    if (mTileMode == 0 || mTileMode == 1) {
-        linear = deswizzleLinear(data, mImageFormat.mBPP); 
+bool Bflim::decodeRGBA(const u8* data, size_t size, std::vector<u8>& output, std::string& error) const {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Decode, size);
+    if (output.capacity() < getDecodedSize()) {
+        BflimProfiler::countAllocation(getDecodedSize());
+    }
+    output.resize(getDecodedSize());
+    if (!decodeInto(data, size, output.data(), output.size(), error)) {
+        output.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Bflim::decodeInto(const u8* data, size_t size, u8* output, size_t outputSize, std::string& error,
+                       BflimScratch* scratch) const {
+    return decodeInto(data, size, output, outputSize, mDecodeOptions, error, scratch);
+}
+
+bool Bflim::decodeInto(const u8* data, size_t size, u8* output, size_t outputSize, const BflimDecodeOptions& options,
+                       std::string& error, BflimScratch* scratch) const {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Decode, size);
+
+    const size_t decodedSize = getDecodedSize(options);
+    if (output == nullptr || outputSize < decodedSize) {
+        error = "Output buffer smaller than the image!";
+        return false;
     }
-    else if (mTileMode == 2 || mTileMode == 3) {
-        linear = deswizzleMacroTiled(data, mImageFormat.mBPP); 
+
+    BflimScratch localScratch;
+    BflimScratch& temp = scratch ? *scratch : localScratch;
+    temp.reset();
+
+    if (!mCache) {
+        return decodeUncachedInto(data, size, output, error, temp, options);
     }
-    else if (mTileMode >= 4 && mTileMode <= 15) {
-        linear = deswizzleMacroTiled(data, mImageFormat.mBPP); 
+
+    BflimCacheKey key = BflimCache::makeKey(mImageWidth, mImageHeight, mImageFormat.mId, mTileMode, mSwizzle, data, size,
+                                            (u8)mPlatform, (u8)options.pixelFormat);
+    if (BflimCache::Image image = mCache->find(key)) {
+        std::memcpy(output, image->data(), std::min(image->size(), decodedSize));
+        return true;
+    }
+
+    if (!decodeUncachedInto(data, size, output, error, temp, options)) {
+        return false;
+    }
+
+    mCache->insert(key, std::vector<u8>(output, output + decodedSize));
+    return true;
+}
+
+size_t Bflim::getDecodedSize() const {
+    return getDecodedSize(mDecodeOptions);
+}
+
+size_t Bflim::getDecodedSize(const BflimDecodeOptions& options) const {
+    return (size_t)mImageWidth * mImageHeight * BflimColor::getBytesPerPixel(options.pixelFormat);
+}
+
+size_t Bflim::getRgbaSize() const {
+    return (size_t)mImageWidth * mImageHeight * 4;
+}
+
+size_t Bflim::getEncodedSize() const {
+    if (mPlatform == BflimPlatform::CTR) {
+        return BflimCtr::getImageSize(mImageFormat.mId, mImageWidth, mImageHeight);
+    }
+    return GX2TileMap::get(createGX2Surface())->getImageSize();
+}
+
+u32 Bflim::getBytesPerElement() const {
+    return (u32)mImageFormat.mBPP * mImageFormat.mBlockDim * mImageFormat.mBlockDim / 8;
+}
+
+bool Bflim::decodeUncachedInto(const u8* data, size_t size, u8* output, std::string& error, BflimScratch& scratch,
+                               const BflimDecodeOptions& options) const {
+
+    if (!isDecodable()) {
+        error = "Format 0x" + hexString(mImageFormat.mId) + " not supported yet!";
+        return false;
+    }
+
+    if (mPlatform == BflimPlatform::CTR) {
+        const size_t pixels = (size_t)mImageWidth * mImageHeight;
+        const size_t rgbaSize = getConversionScratchSize(pixels, options);
+        u8* rgba = rgbaSize ? scratch.allocate(rgbaSize) : output;
+        if (!BflimCtr::decode(data, size, mImageFormat.mId, mImageWidth, mImageHeight, rgba)) {
+            error = "Image data smaller than surface size!";
+            return false;
+        }
+        BflimColor::convert(rgba, output, pixels, options.pixelFormat, BflimColor::isSrgbFormat(mImageFormat.mId));
+        return true;
+    }
+
+    if (mTileMode > 15) {
+        error = "Unknown TileMode: " + std::to_string(mTileMode);
+        return false;
+    }
+
+#ifndef BFLIM_GX2_REFERENCE_TILING
+    if (mTileMode >= 2) {
+        return decodeTiledStreamed(data, size, output, error, scratch, options);
+    }
+#endif
+
+    const u8* linear;
+    std::vector<u8> reference;
+    const u32 blockDim = mImageFormat.mBlockDim;
+    const u32 elementsX = (mImageWidth + blockDim - 1) / blockDim;
+    const u32 elementsY = (mImageHeight + blockDim - 1) / blockDim;
+
+    if (mTileMode == 0 || mTileMode == 1) {
+        // Goes by elements, so BCn blocks in linear surfaces are handled too
+        const size_t elementsSize = (size_t)elementsX * elementsY * getBytesPerElement();
+        BflimProfiler::Scope deswizzleScope(BflimProfiler::Stage::Deswizzle, elementsSize);
+        u8* elements = scratch.allocate(elementsSize);
+        if (!fetchElements(data, size, 0, 0, elementsX, elementsY, elements, error)) {
+            return false;
+        }
+        linear = elements;
     }
     else {
-        std::cerr << "Unknown TileMode: " << (int)mTileMode << std::endl;
-        return std::vector<u8>(mImageWidth * mImageHeight * 4, 128);
+        reference = deswizzleMacroTiled(data, size, mImageFormat.mBPP);
+        if (reference.empty()) {
+            error = "Image data smaller than surface size!";
+            return false;
+        }
+        linear = reference.data();
     }
-    
-    switch (mImageFormat.mId) {
-        case 0x01: return decodeL8(linear);
-        case 0x03: return decodeLA8(linear);
-        case 0x09: return decodeRGBA8(linear);
-        case 0x0C: return decodeBC1(linear);
-        case 0x0D: return decodeBC2(linear);
-        case 0x0E: return decodeBC3(linear);
-        case 0x0F: return decodeBC4L(linear);  // Luminance
-        case 0x10: return decodeBC4A(linear);  // Alpha
-        case 0x11: return decodeBC5(linear);   // RG
-        default:
-            std::cerr << "Format 0x" << std::hex << (int)mImageFormat.mId 
-                      << " not supported yet!" << std::dec << std::endl;
-            return std::vector<u8>(mImageWidth * mImageHeight * 4, 128);
+
+    // Converted in bands of element rows, so the RGBA8 pixels are still in cache when they are converted
+    const size_t elementRowBytes = (size_t)elementsX * getBytesPerElement();
+    const size_t outputRowBytes = (size_t)mImageWidth * BflimColor::getBytesPerPixel(options.pixelFormat);
+    const size_t bandRowBytes = (size_t)mImageWidth * 4 * blockDim;
+    const u32 bandRows = getConversionScratchSize(1, options) ? std::max<size_t>(1, StreamStripBytes / bandRowBytes) : elementsY;
+    u8* rgba = scratch.allocate(getConversionScratchSize((size_t)bandRows * blockDim * mImageWidth, options));
+
+    for (u32 row = 0; row < elementsY; row += bandRows) {
+        const u32 pixelY = row * blockDim;
+        const u32 pixelRows = std::min<u32>(bandRows * blockDim, mImageHeight - pixelY);
+        decodeLinearTo(linear + row * elementRowBytes, output + pixelY * outputRowBytes, mImageWidth, pixelRows, rgba, options);
     }
+    return true;
+}
+
+bool Bflim::decodeRegion(const u8* data, size_t size, u32 x, u32 y, u32 width, u32 height,
+                         std::vector<u8>& output, std::string& error) const {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Decode, size);
+
+    if (!isDecodable()) {
+        error = "Format 0x" + hexString(mImageFormat.mId) + " not supported yet!";
+        return false;
+    }
+
+    if (mTileMode > 15) {
+        error = "Unknown TileMode: " + std::to_string(mTileMode);
+        return false;
+    }
+
+    if (width == 0 || height == 0 || x >= mImageWidth || y >= mImageHeight ||
+        width > mImageWidth - x || height > mImageHeight - y) {
+        error = "Region outside of the image!";
+        return false;
+    }
+
+    if (mPlatform == BflimPlatform::CTR) {
+        // Stored bottom-up in small tiles, so decode the whole texture and crop
+        std::vector<u8> full(getRgbaSize());
+        if (!decodeInto(data, size, full.data(), full.size(), BflimDecodeOptions(), error)) {
+            return false;
+        }
+        output.resize((size_t)width * height * 4);
+        for (u32 row = 0; row < height; row++) {
+            std::memcpy(&output[(size_t)row * width * 4], &full[((size_t)(y + row) * mImageWidth + x) * 4], (size_t)width * 4);
+        }
+        return true;
+    }
+
+    const u32 blockDim = mImageFormat.mBlockDim;
+    const u32 firstX = x / blockDim;
+    const u32 firstY = y / blockDim;
+    const u32 elementsX = (x + width + blockDim - 1) / blockDim - firstX;
+    const u32 elementsY = (y + height + blockDim - 1) / blockDim - firstY;
+
+    std::vector<u8> elements;
+    if (!fetchElements(data, size, firstX, firstY, elementsX, elementsY, elements, error)) {
+        return false;
+    }
+
+    output.resize((size_t)width * height * 4);
+
+    // Whole elements decode straight into the output, partial blocks go through a scratch image
+    const u32 offsetX = x - firstX * blockDim;
+    const u32 offsetY = y - firstY * blockDim;
+    const u32 decodedWidth = elementsX * blockDim;
+    const u32 decodedHeight = elementsY * blockDim;
+    if (offsetX == 0 && offsetY == 0 && decodedWidth == width && decodedHeight == height) {
+        decodeLinear(elements.data(), output.data(), width, height);
+        return true;
+    }
+
+    std::vector<u8> decoded((size_t)decodedWidth * decodedHeight * 4);
+    decodeLinear(elements.data(), decoded.data(), decodedWidth, decodedHeight);
+    for (u32 row = 0; row < height; row++) {
+        std::memcpy(&output[(size_t)row * width * 4],
+                    &decoded[((size_t)(offsetY + row) * decodedWidth + offsetX) * 4], (size_t)width * 4);
+    }
+    return true;
+}
+
+namespace
+{
+    inline u32 read16LE(const u8* data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+
+    inline u32 read32LE(const u8* data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((u32)data[3] << 24);
+    }
+
+    inline u32 popCount(u32 value)
+    {
+        value = value - ((value >> 1) & 0x55555555);
+        value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+        return (((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+    }
+
+    inline void expand565(u32 color, u32 rgb[3])
+    {
+        u32 r = (color >> 11) & 0x1F;
+        u32 g = (color >> 5) & 0x3F;
+        u32 b = color & 0x1F;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Adds the RGBA of all 16 texels of a BC1 colour block without decoding them one by one
+    void sumColorBlock(const u8* block, bool threeColorMode, u32 sum[4])
+    {
+        u32 color0 = read16LE(block);
+        u32 color1 = read16LE(block + 2);
+        u32 indices = read32LE(block + 4);
+
+        // Index histogram from the low/high bit planes of the 2-bit indices
+        u32 low = indices & 0x55555555;
+        u32 high = (indices >> 1) & 0x55555555;
+        u32 counts[4];
+        counts[1] = popCount(low & ~high);
+        counts[2] = popCount(high & ~low);
+        counts[3] = popCount(low & high);
+        counts[0] = 16 - counts[1] - counts[2] - counts[3];
+
+        u32 palette[4][4];
+        expand565(color0, palette[0]);
+        expand565(color1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+        if (color0 > color1 || !threeColorMode) {
+            for (u32 c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            palette[2][3] = palette[3][3] = 255;
+        }
+        else {
+            for (u32 c = 0; c < 3; c++) {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+            palette[2][3] = 255;
+            palette[3][3] = 0;
+        }
+
+        for (u32 i = 0; i < 4; i++) {
+            for (u32 c = 0; c < 4; c++) sum[c] += counts[i] * palette[i][c];
+        }
+    }
+
+    // Sum of the 16 values of a BC3 alpha / BC4 channel block
+    u32 sumChannelBlock(const u8* block)
+    {
+        u32 value0 = block[0];
+        u32 value1 = block[1];
+        u64 indices = 0;
+        for (u32 i = 0; i < 6; i++) indices |= (u64)block[2 + i] << (i * 8);
+
+        u32 palette[8] = { value0, value1 };
+        if (value0 > value1) {
+            for (u32 i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * value0 + i * value1) / 7;
+        }
+        else {
+            for (u32 i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * value0 + i * value1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        u32 sum = 0;
+        for (u32 i = 0; i < 16; i++) sum += palette[(indices >> (i * 3)) & 7];
+        return sum;
+    }
+
+    // RGBA sums over one block, channel mapping as in the full decoders
+    void sumBlock(u8 formatId, const u8* block, u32 sum[4])
+    {
+        switch (formatId) {
+            case 0x0C: case 0x15:
+                sumColorBlock(block, true, sum);
+                break;
+            case 0x0D: case 0x16: {
+                u32 color[4] = {};
+                sumColorBlock(block + 8, false, color);
+                for (u32 c = 0; c < 3; c++) sum[c] += color[c];
+                for (u32 i = 0; i < 8; i++) sum[3] += ((block[i] & 0xF) + (block[i] >> 4)) * 17;
+                break;
+            }
+            case 0x0E: case 0x17: {
+                u32 color[4] = {};
+                sumColorBlock(block + 8, false, color);
+                for (u32 c = 0; c < 3; c++) sum[c] += color[c];
+                sum[3] += sumChannelBlock(block);
+                break;
+            }
+            default: {
+                // BC4 L/A and BC5 are shown as grey from their first channel
+                u32 value = sumChannelBlock(block);
+                sum[0] += value;
+                sum[1] += value;
+                sum[2] += value;
+                sum[3] += 255 * 16;
+                break;
+            }
+        }
+    }
+    // Averages scale x scale boxes of width x rows pixels (stride pixels apart) into
+    // ceil(rows / scale) rows of ceil(width / scale) pixels
+    void boxFilter(const u8* rgba, u32 stride, u32 width, u32 rows, u32 scale, u8* output)
+    {
+        const u32 outputWidth = (width + scale - 1) / scale;
+        for (u32 y = 0; y < rows; y += scale) {
+            u32 boxHeight = std::min(scale, rows - y);
+            for (u32 px = 0; px < outputWidth; px++) {
+                u32 sum[4] = {};
+                u32 boxWidth = std::min(scale, width - px * scale);
+                for (u32 by = 0; by < boxHeight; by++) {
+                    const u8* row = &rgba[((size_t)(y + by) * stride + px * scale) * 4];
+                    for (u32 bx = 0; bx < boxWidth * 4; bx += 4) {
+                        sum[0] += row[bx + 0];
+                        sum[1] += row[bx + 1];
+                        sum[2] += row[bx + 2];
+                        sum[3] += row[bx + 3];
+                    }
+                }
+
+                u32 count = boxWidth * boxHeight;
+                u8* pixel = &output[((size_t)(y / scale) * outputWidth + px) * 4];
+                for (u32 c = 0; c < 4; c++) pixel[c] = (u8)((sum[c] + count / 2) / count);
+            }
+        }
+    }
+}
+
+bool Bflim::decodePreview(const u8* data, size_t size, u32 scale, std::vector<u8>& output, std::string& error) const {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Decode, size);
+
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+        error = "Preview scale must be 1, 2, 4 or 8!";
+        return false;
+    }
+
+    if (scale == 1) {
+        // Previews are RGBA8 whatever setDecodeOptions selected
+        output.resize(getRgbaSize());
+        if (!decodeInto(data, size, output.data(), output.size(), BflimDecodeOptions(), error)) {
+            output.clear();
+            return false;
+        }
+        return true;
+    }
+
+    if (!isDecodable()) {
+        error = "Format 0x" + hexString(mImageFormat.mId) + " not supported yet!";
+        return false;
+    }
+
+    if (mTileMode > 15) {
+        error = "Unknown TileMode: " + std::to_string(mTileMode);
+        return false;
+    }
+
+    const u32 previewWidth = (mImageWidth + scale - 1) / scale;
+    const u32 previewHeight = (mImageHeight + scale - 1) / scale;
+
+    if (mPlatform == BflimPlatform::CTR) {
+        // 3DS textures are at most 1024x1024, decode them whole and filter
+        std::vector<u8> full(getRgbaSize());
+        if (!decodeInto(data, size, full.data(), full.size(), BflimDecodeOptions(), error)) {
+            return false;
+        }
+        output.resize((size_t)previewWidth * previewHeight * 4);
+        boxFilter(full.data(), mImageWidth, mImageWidth, mImageHeight, scale, output.data());
+        return true;
+    }
+
+    output.resize((size_t)previewWidth * previewHeight * 4);
+
+    const bool compressed = mImageFormat.mBlockDim == 4;
+    const u32 blockDim = mImageFormat.mBlockDim;
+    const u32 elementsX = (mImageWidth + blockDim - 1) / blockDim;
+    const u32 elementsY = (mImageHeight + blockDim - 1) / blockDim;
+
+    if (compressed && scale >= 4) {
+        // One averaged colour per block straight from the endpoints and indices
+        const u32 blocksPerPixel = scale / 4;
+
+        // Blocks are read in place, linear modes included (rows at the GX2 surface pitch)
+        std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+        const u32 bytesPerBlock = tileMap->getBytesPerElement();
+        const size_t requiredSize = mTileMode >= 2 ? tileMap->getImageSize()
+                                                   : ((size_t)(elementsY - 1) * tileMap->getPitch() + elementsX) * bytesPerBlock;
+        if (size < requiredSize) {
+            error = "Image data smaller than surface size!";
+            return false;
+        }
+
+        auto blockAt = [&](u32 bx, u32 by) {
+            return data + tileMap->getElementOffset(bx, by);
+        };
+
+        for (u32 py = 0; py < previewHeight; py++) {
+            u32 firstBlockY = py * blocksPerPixel;
+            u32 bandBlocksY = std::min(blocksPerPixel, elementsY - firstBlockY);
+
+            for (u32 px = 0; px < previewWidth; px++) {
+                u32 sum[4] = {};
+                u32 firstBlockX = px * blocksPerPixel;
+                u32 bandBlocksX = std::min(blocksPerPixel, elementsX - firstBlockX);
+                for (u32 by = 0; by < bandBlocksY; by++) {
+                    for (u32 bx = 0; bx < bandBlocksX; bx++) {
+                        sumBlock(mImageFormat.mId, blockAt(firstBlockX + bx, firstBlockY + by), sum);
+                    }
+                }
+
+                u32 texels = bandBlocksX * bandBlocksY * 16;
+                u8* pixel = &output[((size_t)py * previewWidth + px) * 4];
+                for (u32 c = 0; c < 4; c++) pixel[c] = (u8)((sum[c] + texels / 2) / texels);
+            }
+        }
+        return true;
+    }
+
+    // Box filter over decoded bands, a band covers whole element rows
+    const u32 bandRows = std::max(scale, blockDim);
+    const u32 decodedWidth = elementsX * blockDim;
+    std::vector<u8> decoded((size_t)decodedWidth * bandRows * 4);
+    std::vector<u8> band;
+
+    for (u32 y = 0; y < mImageHeight; y += bandRows) {
+        u32 firstElementY = y / blockDim;
+        u32 bandElementsY = std::min(bandRows / blockDim, elementsY - firstElementY);
+        if (!fetchElements(data, size, 0, firstElementY, elementsX, bandElementsY, band, error)) {
+            return false;
+        }
+        decodeLinear(band.data(), decoded.data(), decodedWidth, bandElementsY * blockDim);
+
+        u32 rowsInBand = std::min(bandRows, (u32)mImageHeight - y);
+        boxFilter(decoded.data(), decodedWidth, mImageWidth, rowsInBand, scale,
+                  &output[(size_t)(y / scale) * previewWidth * 4]);
+    }
+    return true;
+}
+
+bool Bflim::fetchElements(const u8* data, size_t size, u32 firstX, u32 firstY, u32 elementsX, u32 elementsY,
+                          std::vector<u8>& elements, std::string& error) const {
+    elements.resize((size_t)elementsX * elementsY * getBytesPerElement());
+    return fetchElements(data, size, firstX, firstY, elementsX, elementsY, elements.data(), error);
+}
+
+bool Bflim::fetchElements(const u8* data, size_t size, u32 firstX, u32 firstY, u32 elementsX, u32 elementsY,
+                          u8* elements, std::string& error) const {
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    const u32 bytesPerElement = tileMap->getBytesPerElement();
+
+    if (mTileMode < 2) {
+        // Rows of elements (4x4 blocks for BCn) at the GX2 surface pitch
+        const u32 pitch = tileMap->getPitch();
+        const size_t rowBytes = (size_t)elementsX * bytesPerElement;
+        const size_t lastByte = ((size_t)(firstY + elementsY - 1) * pitch + firstX) * bytesPerElement + rowBytes;
+        if (size < lastByte) {
+            error = "Image data smaller than surface size!";
+            return false;
+        }
+
+        for (u32 row = 0; row < elementsY; row++) {
+            std::memcpy(&elements[row * rowBytes], &data[((size_t)(firstY + row) * pitch + firstX) * bytesPerElement], rowBytes);
+        }
+        return true;
+    }
+
+    if (size < tileMap->getImageSize()) {
+        error = "Image data smaller than surface size!";
+        return false;
+    }
+
+    if (firstX == 0 && firstY == 0 && elementsX == tileMap->getWidth() && elementsY == tileMap->getHeight()) {
+        // Whole surface, copy contiguous runs instead of single elements
+        tileMap->deswizzle(data, elements);
+        return true;
+    }
+
+    u8* out = elements;
+    for (u32 ey = firstY; ey < firstY + elementsY; ey++) {
+        for (u32 ex = firstX; ex < firstX + elementsX; ex++) {
+            std::memcpy(out, data + tileMap->getElementOffset(ex, ey), bytesPerElement);
+            out += bytesPerElement;
+        }
+    }
+    return true;
+}
+
+bool Bflim::storeElements(const u8* elements, std::string& error) {
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    const u32 bytesPerElement = tileMap->getBytesPerElement();
+
+    if (mTileMode < 2) {
+        // Same addressing as fetchElements
+        const u32 pitch = tileMap->getPitch();
+        const size_t rowBytes = (size_t)tileMap->getWidth() * bytesPerElement;
+        const size_t lastByte = (size_t)(tileMap->getHeight() - 1) * pitch * bytesPerElement + rowBytes;
+        if (mImageDataSize < lastByte || mRawData.size() < mImageDataSize) {
+            error = "Image data smaller than surface size!";
+            return false;
+        }
+
+        for (u32 row = 0; row < tileMap->getHeight(); row++) {
+            std::memcpy(&mRawData[(size_t)row * pitch * bytesPerElement], elements + row * rowBytes, rowBytes);
+        }
+        return true;
+    }
+
+    if (mImageDataSize < tileMap->getImageSize() || mRawData.size() < mImageDataSize) {
+        error = "Image data smaller than surface size!";
+        return false;
+    }
+
+    tileMap->swizzle(elements, mRawData.data());
+    return true;
+}
+
+bool Bflim::deswizzleElements(const u8* data, size_t size, std::vector<u8>& elements, std::string& error) const {
+    if (mPlatform == BflimPlatform::CTR) {
+        error = "3DS textures have no tile modes!";
+        return false;
+    }
+
+    if (mTileMode > 15) {
+        error = "Unknown TileMode: " + std::to_string(mTileMode);
+        return false;
+    }
+
+    if (mImageFormat.mGX2Format == GX2_SURFACE_FORMAT_INVALID) {
+        error = "Format 0x" + hexString(mImageFormat.mId) + " has no GX2 layout!";
+        return false;
+    }
+
+    const u32 blockDim = mImageFormat.mBlockDim;
+    const u32 elementsX = (mImageWidth + blockDim - 1) / blockDim;
+    const u32 elementsY = (mImageHeight + blockDim - 1) / blockDim;
+
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Deswizzle, size);
+    if (!fetchElements(data, size, 0, 0, elementsX, elementsY, elements, error)) return false;
+    BflimProfiler::countAllocation(elements.size());
+    return true;
+}
+
+bool Bflim::retile(u8 targetTileMode, u8 targetSwizzle) {
+    if (targetTileMode > 15) {
+        BFLIM_LOG(BflimLog::Level::Error, "Unknown TileMode: " << (int)targetTileMode);
+        return false;
+    }
+
+    targetSwizzle &= 0x07;
+    if (targetTileMode == mTileMode && targetSwizzle == mSwizzle) {
+        return true;
+    }
+
+    BflimView view;
+    if (!view.parse(mRawData.data(), mRawData.size())) {
+        BFLIM_LOG(BflimLog::Level::Error, "Not a BFLIM file");
+        return false;
+    }
+
+    std::string error;
+    std::vector<u8> elements;
+    if (!deswizzleElements(mRawData.data(), mImageDataSize, elements, error)) {
+        BFLIM_LOG(BflimLog::Level::Error, error);
+        return false;
+    }
+
+    // Header of the new layout first, then the elements go into its payload
+    BflimImageDesc desc = BflimImageDesc::fromInfo(view.getInfo());
+    desc.tileMode = targetTileMode;
+    desc.swizzle = targetSwizzle;
+
+    Bflim target;
+    target.mRawData.resize(BflimWriter::getFileSize(desc));
+    if (!BflimWriter::writeHeader(desc, target.mRawData.data(), target.mRawData.size(), error)) {
+        BFLIM_LOG(BflimLog::Level::Error, error);
+        return false;
+    }
+    target.parseImageInformation(target.mRawData);
+    target.mImageDataSize = target.mRawData.size() - BflimView::ProbeSize;
+
+    {
+        BflimProfiler::Scope scope(BflimProfiler::Stage::Swizzle, elements.size());
+        if (!target.storeElements(elements.data(), error)) {
+            BFLIM_LOG(BflimLog::Level::Error, error);
+            return false;
+        }
+    }
+
+    mRawData = std::move(target.mRawData);
+    parseImageInformation(mRawData);
+    mImageDataSize = mRawData.size() - BflimView::ProbeSize;
+    return true;
+}
+
+bool Bflim::decodeTiledStreamed(const u8* data, size_t size, u8* output, std::string& error, BflimScratch& scratch,
+                                const BflimDecodeOptions& options) const {
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    if (size < tileMap->getImageSize()) {
+        error = "Image data smaller than surface size!";
+        return false;
+    }
+
+    // Pixel rows covered by one element row (4 for BCn blocks)
+    const u32 blockHeight = mImageFormat.mBlockDim;
+    const size_t stripRowBytes = (size_t)tileMap->getWidth() * tileMap->getBytesPerElement() * 8;
+    const u32 stripRows = std::max<size_t>(1, StreamStripBytes / std::max<size_t>(1, stripRowBytes));
+
+    const size_t outputRowBytes = (size_t)mImageWidth * BflimColor::getBytesPerPixel(options.pixelFormat);
+    const size_t stripBytes = ((size_t)stripRows * stripRowBytes + 15) & ~(size_t)15;
+    const size_t taskBytes = stripBytes + getConversionScratchSize((size_t)stripRows * 8 * blockHeight * mImageWidth, options);
+    auto decodeStrips = [&](u32 firstStrip, u32 endStrip, u8* strip) {
+        for (u32 row = firstStrip * stripRows; row < endStrip * stripRows; row += stripRows) {
+            u32 pixelY = row * 8 * blockHeight;
+            if (pixelY >= mImageHeight) break;
+
+            {
+                BflimProfiler::Scope deswizzleScope(BflimProfiler::Stage::Deswizzle, stripRows * stripRowBytes);
+                tileMap->deswizzleRows(data, strip, row, stripRows);
+            }
+
+            u32 pixelRows = std::min<u32>(stripRows * 8 * blockHeight, mImageHeight - pixelY);
+            decodeLinearTo(strip, output + pixelY * outputRowBytes, mImageWidth, pixelRows, strip + stripBytes, options);
+        }
+    };
+
+    const u32 stripCount = (tileMap->getMicroTilesY() + stripRows - 1) / stripRows;
+    if ((u64)mImageWidth * mImageHeight < ParallelDecodeMinPixels || stripCount < 2) {
+        decodeStrips(0, stripCount, scratch.allocate(taskBytes));
+        return true;
+    }
+
+    // Strips write disjoint output rows, so the result does not depend on the thread count.
+    // Each task gets its own strip buffer, allocated up front since the arena is not thread safe.
+    const u32 taskCount = std::min(stripCount, ParallelDecodeMaxTasks);
+    u8* strips = scratch.allocate(taskCount * taskBytes);
+    parallelFor(taskCount, [&](u32 task) {
+        decodeStrips((u64)stripCount * task / taskCount, (u64)stripCount * (task + 1) / taskCount,
+                     strips + task * taskBytes);
+    });
+    return true;
 }
 
 std::vector<u8> Bflim::encodeRGBA8(const std::vector<u8>& rgbaData) {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Encode, rgbaData.size());
     std::vector<u8> output(rgbaData.size());
+    BflimProfiler::countAllocation(output.size());
     
     for (size_t i = 0; i < rgbaData.size(); i += 4) {
         u8 r = rgbaData[i + 0];
@@ -350,7 +1035,9 @@ std::vector<u8> Bflim::encodeRGBA8(const std::vector<u8>& rgbaData) {
 }
 
 std::vector<u8> Bflim::swizzleMacroTiled(const std::vector<u8>& linearData) {
-    
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Swizzle, linearData.size());
+
+#ifdef BFLIM_GX2_REFERENCE_TILING
     GX2Surface srcSurf;
     std::memset(&srcSurf, 0, sizeof(GX2Surface));
     srcSurf.dim = GX2_SURFACE_DIM_2D;
@@ -377,81 +1064,357 @@ std::vector<u8> Bflim::swizzleMacroTiled(const std::vector<u8>& linearData) {
     GX2CopySurface(&srcSurf, 0, 0, &dstSurf, 0, 0);
     
     return output;
+#else
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    if (linearData.size() < tileMap->getLinearSize()) {
+        BFLIM_LOG(BflimLog::Level::Error, "Linear data smaller than surface!");
+        return std::vector<u8>();
+    }
+
+    std::vector<u8> output(tileMap->getImageSize());
+    BflimProfiler::countAllocation(output.size());
+    tileMap->swizzle(linearData.data(), output.data());
+    return output;
+#endif
 }
 
 bool Bflim::replaceWithRGBA(const std::vector<u8>& rgbaData) {
-    if (mTileMode < 2 || mTileMode > 15) {
-        std::cerr << "Only tiled modes (2-15) supported!" << std::endl;
+    std::string error;
+    if (mRawData.size() < mImageDataSize) {
+        error = "Image data smaller than surface size!";
+    }
+    else if (encodeInto(rgbaData.data(), rgbaData.size(), mRawData.data(), mImageDataSize, error)) {
+        return true;
+    }
+
+    BFLIM_LOG(BflimLog::Level::Error, error);
+    return false;
+}
+
+bool Bflim::encodeInto(const u8* rgbaData, size_t rgbaSize, u8* output, size_t outputSize, std::string& error,
+                       BflimScratch* scratch) {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Encode, rgbaSize);
+
+    if (rgbaData == nullptr || rgbaSize < getRgbaSize()) {
+        error = "RGBA data smaller than image!";
         return false;
     }
 
-    std::vector<u8> encoded;
+    mEncodeMetrics = BflimEncodeMetrics();
 
-    switch (mImageFormat.mId) {
-        case 0x09: encoded = encodeRGBA8(rgbaData); break;
-        case 0x0C: encoded = encodeBC1(rgbaData); break;
-        case 0x0E: encoded = encodeBC3(rgbaData); break;
-        default:
-            std::cerr << "Format 0x" << std::hex << (int)mImageFormat.mId 
-                      << " encoding not implemented!" << std::dec << std::endl;
+    if (mPlatform == BflimPlatform::CTR) {
+        if (!BflimCtr::isEncodable(mImageFormat.mId)) {
+            error = "Format 0x" + hexString(mImageFormat.mId) + " encoding not implemented!";
             return false;
+        }
+
+        if (output == nullptr ||
+            !BflimCtr::encode(rgbaData, mImageFormat.mId, mImageWidth, mImageHeight, output, outputSize)) {
+            error = "Image data smaller than surface size!";
+            return false;
+        }
+        return true;
     }
 
-    std::vector<u8> swizzled = swizzleMacroTiled(encoded);
-    
-    mImageData = swizzled;
-    updateRawData();
+    if (mTileMode < 2 || mTileMode > 15) {
+        error = "Only tiled modes (2-15) supported!";
+        return false;
+    }
+
+    const BflimEncoders::Codec& codec = BflimEncoders::get(mImageFormat.mId);
+    if (!codec.encode || mImageFormat.mGX2Format == GX2_SURFACE_FORMAT_INVALID) {
+        error = "Format 0x" + hexString(mImageFormat.mId) + " encoding not implemented!";
+        return false;
+    }
+
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    if (output == nullptr || outputSize < tileMap->getImageSize()) {
+        error = "Image data smaller than surface size!";
+        return false;
+    }
+
+#ifdef BFLIM_GX2_REFERENCE_TILING
+    BflimScratch localScratch;
+    BflimScratch& temp = scratch ? *scratch : localScratch;
+    temp.reset();
+
+    u8* linear = temp.allocate(tileMap->getLinearSize());
+    encodeElements(mImageFormat, rgbaData, linear);
+
+    std::vector<u8> swizzled = swizzleMacroTiled(std::vector<u8>(linear, linear + tileMap->getLinearSize()));
+    if (swizzled.empty()) {
+        error = "Linear data smaller than surface!";
+        return false;
+    }
+    std::memcpy(output, swizzled.data(), std::min(swizzled.size(), outputSize));
+#else
+    (void)scratch;
+    if (mImageFormat.mBlockDim == 1 && !mEncodeOptions.computeMetrics) {
+        // RGBA8 is stored as is, so the input already is the linear surface
+        BflimProfiler::Scope swizzleScope(BflimProfiler::Stage::Swizzle, getRgbaSize());
+        tileMap->swizzle(rgbaData, output);
+    }
+    else {
+        // Every block goes straight to its tiled offset, no linear copy in between
+        const u32 blockDim = mImageFormat.mBlockDim;
+        encodeTiled(*tileMap, rgbaData, nullptr, output, 0, 0, (mImageWidth + blockDim - 1) / blockDim,
+                    (mImageHeight + blockDim - 1) / blockDim);
+    }
+#endif
     return true;
 }
 
-void Bflim::updateRawData() {
-    
-    if (mImageData.size() <= mRawData.size()) {
-        std::memcpy(mRawData.data(), mImageData.data(), mImageData.size());
+void Bflim::updateRawData(const std::vector<u8>& imageData) {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::RawDataUpdate, imageData.size());
+
+    if (imageData.size() <= mImageDataSize) {
+        std::memcpy(mRawData.data(), imageData.data(), imageData.size());
     } else {
-        std::cerr << "Image data größer als Raw data buffer!" << std::endl;
+        BFLIM_LOG(BflimLog::Level::Error, "Image data größer als Raw data buffer!");
     }
 }
 
-#define STB_DXT_IMPLEMENTATION
-#include <stb_dxt.h>
+bool Bflim::rebuildWithRGBA(const BflimImageDesc& desc, const std::vector<u8>& rgbaData) {
+    std::string error;
+    std::vector<u8> file = BflimWriter::writeRGBA(desc, rgbaData, error, mEncodeOptions);
+    if (file.empty()) {
+        BFLIM_LOG(BflimLog::Level::Error, error);
+        return false;
+    }
+
+    mRawData = std::move(file);
+    parseImageInformation(mRawData);
+    mImageDataSize = mRawData.size() - BflimView::ProbeSize;
+    return true;
+}
 
 std::vector<u8> Bflim::encodeBC1(const std::vector<u8>& rgbaData) {
-    u32 blockWidth = (mImageWidth + 3) / 4;
-    u32 blockHeight = (mImageHeight + 3) / 4;
-    std::vector<u8> output(blockWidth * blockHeight * 8); // BC1 hat 8 Bytes pro Block
+    return encodeElements(BflimConstants::SupportedFormats[0x0C], rgbaData); // BC1 hat 8 Bytes pro Block
+}
 
-    for (u32 y = 0; y < mImageHeight; y += 4) {
-        for (u32 x = 0; x < mImageWidth; x += 4) {
+std::vector<u8> Bflim::encodeBC3(const std::vector<u8>& rgbaData) {
+    return encodeElements(BflimConstants::SupportedFormats[0x0E], rgbaData); // BC3 hat 16 Bytes pro Block
+}
+
+std::vector<u8> Bflim::encodeElements(const Format& format, const std::vector<u8>& rgbaData) {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Encode, rgbaData.size());
+    u32 elementsX = (mImageWidth + format.mBlockDim - 1) / format.mBlockDim;
+    u32 elementsY = (mImageHeight + format.mBlockDim - 1) / format.mBlockDim;
+    std::vector<u8> output((size_t)elementsX * elementsY * format.mBPP * format.mBlockDim * format.mBlockDim / 8);
+    BflimProfiler::countAllocation(output.size());
+
+    if (rgbaData.size() < getRgbaSize()) {
+        BFLIM_LOG(BflimLog::Level::Error, "RGBA data smaller than image!");
+        return std::vector<u8>();
+    }
+
+    encodeElements(format, rgbaData.data(), output.data());
+    return output;
+}
+
+void Bflim::encodeElements(const Format& format, const u8* rgbaData, u8* output) {
+    const BflimEncoders::Codec& codec = BflimEncoders::get(format.mId);
+    const u32 blockDim = format.mBlockDim;
+    const u32 elementBytes = format.mBPP * blockDim * blockDim / 8;
+    const u32 elementsX = (mImageWidth + blockDim - 1) / blockDim;
+    const u32 elementsY = (mImageHeight + blockDim - 1) / blockDim;
+    const BflimEncodeQuality quality = mEncodeOptions.quality;
+    const bool measure = mEncodeOptions.computeMetrics;
+
+    if (blockDim == 1 && !measure) {
+        // RGBA8 is the only encodable uncompressed format and is stored as is
+        std::memcpy(output, rgbaData, getRgbaSize());
+        return;
+    }
+
+    std::vector<u64> rowErrors(measure ? elementsY : 0);
+
+    // Every element row is independent, so the output does not depend on the thread count
+    auto encodeRow = [&](u32 ey) {
+        u64 rowError = 0;
+        for (u32 ex = 0; ex < elementsX; ex++) {
             u8 blockPixels[64]; // 4x4 RGBA
-            // Hier Pixel aus rgbaData in den 4x4 Block kopieren (mit Padding für Ränder)
-            fillBlock(rgbaData, blockPixels, x, y); 
+            const u8* pixels = blockPixels;
+            if (blockDim == 1) {
+                pixels = rgbaData + ((size_t)ey * mImageWidth + ex) * 4;
+            }
+            else {
+                // Hier Pixel aus rgbaData in den 4x4 Block kopieren (mit Padding für Ränder)
+                fillBlock(rgbaData, blockPixels, ex * 4, ey * 4);
+            }
 
-            u32 blockIdx = ((y/4) * blockWidth + (x/4)) * 8;
-            stb_compress_dxt_block(&output[blockIdx], blockPixels, 0, STB_DXT_NORMAL); // 0 = BC1
+            u8* element = output + ((size_t)ey * elementsX + ex) * elementBytes;
+            codec.encode(pixels, element, quality);
+            if (measure) rowError += codec.error(pixels, element);
         }
+        if (measure) rowErrors[ey] = rowError;
+    };
+
+    if (blockDim == 1 || elementsX * elementsY < ParallelEncodeMinBlocks) {
+        for (u32 ey = 0; ey < elementsY; ey++) encodeRow(ey);
+    }
+    else {
+        parallelFor(elementsY, encodeRow);
+    }
+
+    if (measure) {
+        u64 error = 0;
+        for (u64 rowError : rowErrors) error += rowError;
+        setEncodeMetrics(error, (u64)elementsX * elementsY * blockDim * blockDim * codec.channels);
     }
-    return output;
 }
 
-std::vector<u8> Bflim::encodeBC3(const std::vector<u8>& rgbaData) {
-    u32 blockWidth = (mImageWidth + 3) / 4;
-    u32 blockHeight = (mImageHeight + 3) / 4;
-    std::vector<u8> output(blockWidth * blockHeight * 16); // BC3 hat 16 Bytes pro Block
+void Bflim::setEncodeMetrics(u64 error, u64 samples) {
+    mEncodeMetrics = BflimEncodeMetrics();
+    if (samples == 0) return;
+
+    mEncodeMetrics.valid = true;
+    mEncodeMetrics.mse = (double)error / samples;
+    mEncodeMetrics.psnr = error == 0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / mEncodeMetrics.mse);
+}
+
+bool Bflim::replaceRegionWithRGBA(const std::vector<u8>& rgbaData, u32 x, u32 y, u32 width, u32 height) {
+    if (width == 0 || height == 0 || x >= mImageWidth || y >= mImageHeight ||
+        width > mImageWidth - x || height > mImageHeight - y) {
+        BFLIM_LOG(BflimLog::Level::Error, "Region outside of the image!");
+        return false;
+    }
+
+    u32 blockDim = mImageFormat.mBlockDim;
+    return encodeElementsInPlace(rgbaData, nullptr, x / blockDim, y / blockDim,
+                                 (x + width - 1) / blockDim + 1, (y + height - 1) / blockDim + 1);
+}
+
+bool Bflim::replaceChangedRGBA(const std::vector<u8>& previousRgba, const std::vector<u8>& rgbaData) {
+    if (previousRgba.size() != rgbaData.size()) {
+        BFLIM_LOG(BflimLog::Level::Error, "Previous RGBA data has a different size!");
+        return false;
+    }
+
+    u32 blockDim = mImageFormat.mBlockDim;
+    return encodeElementsInPlace(rgbaData, &previousRgba, 0, 0,
+                                 (mImageWidth + blockDim - 1) / blockDim, (mImageHeight + blockDim - 1) / blockDim);
+}
+
+bool Bflim::encodeElementsInPlace(const std::vector<u8>& rgbaData, const std::vector<u8>* previousRgba,
+                                  u32 firstX, u32 firstY, u32 endX, u32 endY) {
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Encode);
+
+    if (mPlatform == BflimPlatform::CTR) {
+        // 3DS textures are small enough to simply re-encode every tile
+        return replaceWithRGBA(rgbaData);
+    }
+
+    if (mTileMode < 2 || mTileMode > 15) {
+        BFLIM_LOG(BflimLog::Level::Error, "Only tiled modes (2-15) supported!");
+        return false;
+    }
+
+    const BflimEncoders::Codec& codec = BflimEncoders::get(mImageFormat.mId);
+    if (!codec.encode || mImageFormat.mGX2Format == GX2_SURFACE_FORMAT_INVALID) {
+        BFLIM_LOG(BflimLog::Level::Error, "Format 0x" << hexString(mImageFormat.mId) << " encoding not implemented!");
+        return false;
+    }
+
+    if (rgbaData.size() < (size_t)mImageWidth * mImageHeight * 4) {
+        BFLIM_LOG(BflimLog::Level::Error, "RGBA data smaller than image!");
+        return false;
+    }
+
+    std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(createGX2Surface());
+    if (mImageDataSize < tileMap->getImageSize() || mRawData.size() < mImageDataSize) {
+        BFLIM_LOG(BflimLog::Level::Error, "Image data smaller than surface size!");
+        return false;
+    }
+
+    encodeTiled(*tileMap, rgbaData.data(), previousRgba ? previousRgba->data() : nullptr, mRawData.data(),
+                firstX, firstY, endX, endY);
+    return true;
+}
+
+void Bflim::encodeTiled(const GX2TileMap& tileMap, const u8* rgbaData, const u8* previousRgba, u8* tiled,
+                        u32 firstX, u32 firstY, u32 endX, u32 endY) {
+    const BflimEncoders::Codec& codec = BflimEncoders::get(mImageFormat.mId);
+    const u32 blockDim = mImageFormat.mBlockDim;
+    const BflimEncodeQuality quality = mEncodeOptions.quality;
+    const bool measure = mEncodeOptions.computeMetrics;
+    const u32 rowBytes = mImageWidth * 4;
+
+    // Compares the pixels one element covers, clamped to the image like fillBlock pads them
+    auto elementChanged = [&](u32 ex, u32 ey) {
+        u32 px = ex * blockDim;
+        u32 py = ey * blockDim;
+        u32 bytes = (std::min(px + blockDim, (u32)mImageWidth) - px) * 4;
+        u32 endRow = std::min(py + blockDim, (u32)mImageHeight);
+        for (u32 row = py; row < endRow; row++) {
+            size_t offset = (size_t)row * rowBytes + px * 4;
+            if (std::memcmp(rgbaData + offset, previousRgba + offset, bytes) != 0) return true;
+        }
+        return false;
+    };
+
+    u32 rows = endY - firstY;
+    std::vector<u64> rowErrors(measure ? rows : 0);
+    std::vector<u64> rowElements(measure ? rows : 0);
+
+    // Each element lands at its own tiled offset, so rows can be written concurrently
+    auto encodeRow = [&](u32 row) {
+        u32 ey = firstY + row;
+        for (u32 ex = firstX; ex < endX; ex++) {
+            if (previousRgba && !elementChanged(ex, ey)) continue;
 
-    for (u32 y = 0; y < mImageHeight; y += 4) {
-        for (u32 x = 0; x < mImageWidth; x += 4) {
             u8 blockPixels[64];
-            fillBlock(rgbaData, blockPixels, x, y);
+            const u8* pixels = blockPixels;
+            if (blockDim == 1) {
+                pixels = rgbaData + ((size_t)ey * mImageWidth + ex) * 4;
+            }
+            else {
+                fillBlock(rgbaData, blockPixels, ex * 4, ey * 4);
+            }
 
-            u32 blockIdx = ((y/4) * blockWidth + (x/4)) * 16;
-            stb_compress_dxt_block(&output[blockIdx], blockPixels, 1, STB_DXT_NORMAL); // 1 = BC3
+            u8* element = tiled + tileMap.getElementOffset(ex, ey);
+            codec.encode(pixels, element, quality);
+            if (measure) {
+                rowErrors[row] += codec.error(pixels, element);
+                rowElements[row]++;
+            }
         }
+    };
+
+    if (blockDim == 1 || (endX - firstX) * rows < ParallelEncodeMinBlocks) {
+        for (u32 row = 0; row < rows; row++) encodeRow(row);
+    }
+    else {
+        parallelFor(rows, encodeRow);
+    }
+
+    mEncodeMetrics = BflimEncodeMetrics();
+    if (measure) {
+        // Only the encoded elements count
+        u64 error = 0;
+        u64 elements = 0;
+        for (u32 row = 0; row < rows; row++) {
+            error += rowErrors[row];
+            elements += rowElements[row];
+        }
+        setEncodeMetrics(error, elements * blockDim * blockDim * codec.channels);
+    }
+}
+
+void Bflim::parallelFor(u32 count, const std::function<void(u32)>& task) const {
+    if (mExecutor) {
+        mExecutor(count, task);
+    }
+    else {
+        BflimThreadPool::getDefault().parallelFor(count, task);
     }
-    return output;
 }
 
 void Bflim::fillBlock(const std::vector<u8>& rgbaData, u8* block, u32 startX, u32 startY) {
+    fillBlock(rgbaData.data(), block, startX, startY);
+}
+
+void Bflim::fillBlock(const u8* rgbaData, u8* block, u32 startX, u32 startY) const {
     for (u32 i = 0; i < 4; i++) {
         for (u32 j = 0; j < 4; j++) {
             u32 currX = std::min(startX + j, (u32)mImageWidth - 1);
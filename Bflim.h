@@ -3,37 +3,89 @@
 #include <vector>
 #include <types.h>
 #include <BflimFormats.h>
+#include <BflimView.h>
+#include <BflimThreadPool.h>
+#include <BflimCache.h>
+#include <BflimEncoders.h>
+#include <BflimColor.h>
+#include <BflimWriter.h>
+#include <BflimScratch.h>
 #include <ninTexUtils/gx2/gx2Surface.h>
 
+class GX2TileMap;
+
 class Bflim
 {
 public:
     bool isValid(const std::vector<u8>& data);
     void parseImageInformation(const std::vector<u8>& data);
+    void parseImageInformation(const BflimView& view);
     void parseBinary(const std::vector<u8>& data);
 
-    std::vector<u8> deswizzleLinear(const std::vector<u8>& data , u32 Bpp);
+    std::vector<u8> deswizzleLinear(const std::vector<u8>& data , u32 Bpp) const;
+    std::vector<u8> deswizzleLinear(const u8* data, size_t size, u32 Bpp) const;
     std::vector<u8> deswizzleMicroTiled(const std::vector<u8>& data, u32 Bpp);
-    std::vector<u8> deswizzleMacroTiled(const std::vector<u8>& data, u32 Bpp);
+    std::vector<u8> deswizzleMacroTiled(const std::vector<u8>& data, u32 Bpp) const;
+    std::vector<u8> deswizzleMacroTiled(const u8* data, size_t size, u32 Bpp) const;
 
-    std::vector<u8> getDeswizzledRGBA(const std::vector<u8>& data);
+    std::vector<u8> getDeswizzledRGBA(const std::vector<u8>& data) const;
+    std::vector<u8> getDeswizzledRGBA(const u8* data, size_t size) const;
+    // Like getDeswizzledRGBA, but reports failures instead of printing them.
+    // decodeRGBA and decodeInto write pixels in the layout set with setDecodeOptions.
+    bool decodeRGBA(const u8* data, size_t size, std::vector<u8>& output, std::string& error) const;
+    // Same into a caller buffer of at least getDecodedSize() bytes. Temporary buffers come
+    // from scratch (reset on entry) or are allocated for this call when it is null.
+    bool decodeInto(const u8* data, size_t size, u8* output, size_t outputSize, std::string& error,
+                    BflimScratch* scratch = nullptr) const;
+    // Same with explicit options instead of setDecodeOptions(), for instances shared between threads
+    bool decodeInto(const u8* data, size_t size, u8* output, size_t outputSize, const BflimDecodeOptions& options,
+                    std::string& error, BflimScratch* scratch = nullptr) const;
+    // Encodes width * height RGBA8 pixels into a caller buffer of at least getEncodedSize()
+    // bytes, writing every block straight to its tiled offset; only texel bytes are written
+    bool encodeInto(const u8* rgbaData, size_t rgbaSize, u8* output, size_t outputSize, std::string& error,
+                    BflimScratch* scratch = nullptr);
+    // width * height * bytes per pixel of the decode pixel format
+    size_t getDecodedSize() const;
+    size_t getDecodedSize(const BflimDecodeOptions& options) const;
+    // Size of the tiled surface
+    size_t getEncodedSize() const;
+    // Decodes only the blocks covering the rectangle into width * height * 4 bytes of RGBA8
+    bool decodeRegion(const u8* data, size_t size, u32 x, u32 y, u32 width, u32 height,
+                      std::vector<u8>& output, std::string& error) const;
+    // Thumbnail at 1/scale (1, 2, 4 or 8) of the full size, ceil(width / scale) x ceil(height / scale).
+    // BCn blocks are averaged from their endpoints and indices instead of being decoded.
+    bool decodePreview(const u8* data, size_t size, u32 scale, std::vector<u8>& output, std::string& error) const;
+    // Stored elements (texels, or 4x4 blocks for BCn) in row-major order without decoding them, Wii U only
+    bool deswizzleElements(const u8* data, size_t size, std::vector<u8>& elements, std::string& error) const;
     GX2SurfaceFormat bflimFormatToGX2(u8 bflimFormat)const; 
 
-    std::vector<u8> decodeRGBA8(const std::vector<u8>& data);
-    std::vector<u8> decodeBC1(const std::vector<u8>& data);
-    std::vector<u8> decodeBC2(const std::vector<u8>& data);
-    std::vector<u8> decodeBC3(const std::vector<u8>& data);
-    std::vector<u8> decodeBC4L(const std::vector<u8>& data);
-    std::vector<u8> decodeBC4A(const std::vector<u8>& data);
-    std::vector<u8> decodeBC5(const std::vector<u8>& data);
-    std::vector<u8> decodeL8(const std::vector<u8>& data);
-    std::vector<u8> decodeLA8(const std::vector<u8>& data);
+    std::vector<u8> decodeRGBA8(const std::vector<u8>& data) const;
+    std::vector<u8> decodeBC1(const std::vector<u8>& data) const;
+    std::vector<u8> decodeBC2(const std::vector<u8>& data) const;
+    std::vector<u8> decodeBC3(const std::vector<u8>& data) const;
+    std::vector<u8> decodeBC4L(const std::vector<u8>& data) const;
+    std::vector<u8> decodeBC4A(const std::vector<u8>& data) const;
+    std::vector<u8> decodeBC5(const std::vector<u8>& data) const;
+    std::vector<u8> decodeL8(const std::vector<u8>& data) const;
+    std::vector<u8> decodeLA8(const std::vector<u8>& data) const;
+
+    bool isDecodable() const;
+    // Decodes width x height pixels of deswizzled data into RGBA8 (width * height * 4 bytes)
+    bool decodeLinear(const u8* linear, u8* output, u32 width, u32 height) const;
 
     GX2Surface createGX2Surface() const;
+    static GX2Surface createGX2Surface(u16 width, u16 height, u8 formatId, u8 tileMode, u8 swizzle);
 
     void fillBlock(const std::vector<u8>& rgbaData, u8* block, u32 startX, u32 startY);
+    void fillBlock(const u8* rgbaData, u8* block, u32 startX, u32 startY) const;
     
     bool replaceWithRGBA(const std::vector<u8>& rgbaData);
+    // Re-encodes only the blocks touching the rectangle and writes them to their
+    // tiled offsets in the raw data. rgbaData is the whole new image; the rectangle must
+    // lie inside it, like for decodeRegion.
+    bool replaceRegionWithRGBA(const std::vector<u8>& rgbaData, u32 x, u32 y, u32 width, u32 height);
+    // Same, but re-encodes every block whose pixels differ from previousRgba
+    bool replaceChangedRGBA(const std::vector<u8>& previousRgba, const std::vector<u8>& rgbaData);
 
     std::vector<u8> swizzleMacroTiled(const std::vector<u8>& linearData);
     std::vector<u8> encodeRGBA8(const std::vector<u8>& rgbaData);
@@ -41,46 +93,170 @@ public:
     std::vector<u8> encodeBC3(const std::vector<u8>& rgbaData);
     std::vector<u8> encodeBC1(const std::vector<u8>& rgbaData);
 
-    void updateRawData();
+    // Parallel work (block encoding) goes to this executor, or to
+    // BflimThreadPool::getDefault() when none is set
+    void setExecutor(BflimExecutor executor)
+    {
+        mExecutor = std::move(executor);
+    }
 
-    u16 getImageWidth()
+    void setThreadPool(BflimThreadPool& pool)
+    {
+        mExecutor = pool.getExecutor();
+    }
+
+    // Decoded images are looked up in / stored to this cache (not owned, may be shared)
+    void setCache(BflimCache* cache)
+    {
+        mCache = cache;
+    }
+
+    // Quality tier and optional error metrics for encodeInto, replaceWithRGBA and the partial updates
+    void setEncodeOptions(const BflimEncodeOptions& options)
+    {
+        mEncodeOptions = options;
+    }
+
+    const BflimEncodeOptions& getEncodeOptions() const
+    {
+        return mEncodeOptions;
+    }
+
+    // Output pixel format of decodeInto/decodeRGBA (RGBA8 by default); regions and previews stay RGBA8
+    void setDecodeOptions(const BflimDecodeOptions& options)
+    {
+        mDecodeOptions = options;
+    }
+
+    const BflimDecodeOptions& getDecodeOptions() const
+    {
+        return mDecodeOptions;
+    }
+
+    // Filled by the last Wii U encode when BflimEncodeOptions::computeMetrics is set
+    const BflimEncodeMetrics& getEncodeMetrics() const
+    {
+        return mEncodeMetrics;
+    }
+
+    // Same-size copy over the payload; rebuildWithRGBA changes the layout
+    void updateRawData(const std::vector<u8>& imageData);
+    // Replaces the whole file with one of a new size, format or tile mode (see BflimWriter)
+    bool rebuildWithRGBA(const BflimImageDesc& desc, const std::vector<u8>& rgbaData);
+    // Moves the stored pixels/blocks to another Wii U tile mode and swizzle without
+    // decoding them, so the result is bit exact. The file size follows the new surface.
+    bool retile(u8 targetTileMode, u8 targetSwizzle);
+
+    u16 getImageWidth() const
     {
         return mImageWidth;
     }
 
-    u16 getImageHeight()
+    u16 getImageHeight() const
     {
         return mImageHeight;
     }
 
-    Format getImageFormat()
+    const Format& getImageFormat() const
     {
         return mImageFormat;
     }
 
-    std::vector<u8> getImageData()
+    // Copies the payload, use getImageDataPtr()/getImageDataSize() to avoid that
+    std::vector<u8> getImageData() const
+    {
+        return std::vector<u8>(mRawData.begin(), mRawData.begin() + mImageDataSize);
+    }
+
+    const u8* getImageDataPtr() const
+    {
+        return mRawData.data();
+    }
+
+    size_t getImageDataSize() const
     {
-        return mImageData;
+        return mImageDataSize;
     }
 
-    u8 getTileMode()
+    u8 getTileMode() const
     {
         return mTileMode;
     }
 
-    std::vector<u8> getRawData()
+    u8 getSwizzle() const
+    {
+        return mSwizzle;
+    }
+
+    BflimPlatform getPlatform() const
+    {
+        return mPlatform;
+    }
+
+    const std::vector<u8>& getRawData() const
     {
         return mRawData;
     }
 
 private:
-    std::vector<u8> mImageData;
+    // Scratch size for one strip of micro tile rows in the streamed decode
+    static constexpr size_t StreamStripBytes = 128 * 1024;
+
+    // Textures with fewer 4x4 blocks are encoded on the calling thread
+    static constexpr u32 ParallelEncodeMinBlocks = 1024;
+    // Smaller tiled surfaces are decoded on the calling thread
+    static constexpr u32 ParallelDecodeMinPixels = 512 * 512;
+    // Upper bound for the strip buffers of a parallel decode (one per task)
+    static constexpr u32 ParallelDecodeMaxTasks = 32;
+
+    // width * height * 4, the RGBA8 size used by the encoders, regions and previews
+    size_t getRgbaSize() const;
+    u32 getLinearPitch(u32 Bpp) const;
+    size_t getLinearSurfaceSize(u32 Bpp) const;
+    // Bytes per pixel, or per 4x4 block for BCn formats
+    u32 getBytesPerElement() const;
+    bool decodeUncachedInto(const u8* data, size_t size, u8* output, std::string& error, BflimScratch& scratch,
+                            const BflimDecodeOptions& options) const;
+    // Gathers a rectangle of elements (pixels or 4x4 blocks) from the stored layout into a packed buffer
+    bool fetchElements(const u8* data, size_t size, u32 firstX, u32 firstY, u32 elementsX, u32 elementsY,
+                       std::vector<u8>& elements, std::string& error) const;
+    bool fetchElements(const u8* data, size_t size, u32 firstX, u32 firstY, u32 elementsX, u32 elementsY,
+                       u8* elements, std::string& error) const;
+    // Inverse of fetchElements for the whole surface, writes into mRawData
+    bool storeElements(const u8* elements, std::string& error);
+    // decodeLinear plus the conversion to the decode pixel format; rgba takes the RGBA8
+    // pixels first when the output format is wider (getConversionScratchSize bytes)
+    void decodeLinearTo(const u8* linear, u8* output, u32 width, u32 height, u8* rgba,
+                        const BflimDecodeOptions& options) const;
+    // 0 when the conversion works in place
+    size_t getConversionScratchSize(size_t pixels, const BflimDecodeOptions& options) const;
+    bool decodeTiledStreamed(const u8* data, size_t size, u8* output, std::string& error, BflimScratch& scratch,
+                             const BflimDecodeOptions& options) const;
+    bool encodeElementsInPlace(const std::vector<u8>& rgbaData, const std::vector<u8>* previousRgba,
+                               u32 firstX, u32 firstY, u32 endX, u32 endY);
+    // Encodes elements [firstX, endX) x [firstY, endY) straight to their tiled offsets. With
+    // previousRgba, elements whose pixels did not change are skipped.
+    void encodeTiled(const GX2TileMap& tileMap, const u8* rgbaData, const u8* previousRgba, u8* tiled,
+                     u32 firstX, u32 firstY, u32 endX, u32 endY);
+    std::vector<u8> encodeElements(const Format& format, const std::vector<u8>& rgbaData);
+    // Whole image into packed elements of the given format, with the current encode options
+    void encodeElements(const Format& format, const u8* rgbaData, u8* output);
+    void setEncodeMetrics(u64 error, u64 samples);
+    void parallelFor(u32 count, const std::function<void(u32)>& task) const;
+
+    size_t mImageDataSize = 0;
     u16 mImageWidth;
     u16 mImageHeight;
     Format mImageFormat;
+    BflimPlatform mPlatform = BflimPlatform::WiiU;
     u8 mTileMode;
     u8 mSwizzle;
     u8 mPipeSwizzle; 
     u8 mBankSwizzle; 
     std::vector<u8> mRawData;
+    BflimExecutor mExecutor;
+    BflimCache* mCache = nullptr;
+    BflimEncodeOptions mEncodeOptions;
+    BflimEncodeMetrics mEncodeMetrics;
+    BflimDecodeOptions mDecodeOptions;
 };
@@ -0,0 +1,155 @@
+#include <BflimBatch.h>
+#include <Bflim.h>
+#include <BflimView.h>
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    size_t estimateCost(const BflimBatchInput& input)
+    {
+        if (input.data) return input.size;
+
+        std::error_code ec;
+        auto size = std::filesystem::file_size(input.path, ec);
+        return ec ? 0 : (size_t)size;
+    }
+
+    // Owner takes from the front (largest first), thieves take from the back
+    bool popLocal(WorkQueue& queue, size_t& item)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.items.empty()) return false;
+        item = queue.items.front();
+        queue.items.pop_front();
+        return true;
+    }
+
+    bool steal(std::vector<std::unique_ptr<WorkQueue>>& queues, size_t self, size_t& item)
+    {
+        for (size_t offset = 1; offset < queues.size(); offset++) {
+            WorkQueue& victim = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.items.empty()) {
+                item = victim.items.back();
+                victim.items.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void runSerially(u32 count, const std::function<void(u32)>& task)
+    {
+        for (u32 i = 0; i < count; i++) task(i);
+    }
+}
+
+BflimBatch::BflimBatch(u32 threadCount)
+    : mThreadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+BflimBatchResult BflimBatch::process(const BflimBatchInput& input, BflimCache* cache)
+{
+    BflimBatchResult result;
+
+    BflimMappedFile file;
+    const u8* data = input.data;
+    size_t size = input.size;
+
+    if (!data) {
+        if (!file.open(input.path)) {
+            result.error = "Cannot open file";
+            return result;
+        }
+        data = file.data();
+        size = file.size();
+    }
+
+    BflimView view;
+    if (!view.parse(data, size)) {
+        result.error = "Not a BFLIM file";
+        return result;
+    }
+
+    result.width = view.getImageWidth();
+    result.height = view.getImageHeight();
+    result.formatId = view.getFormatId();
+    result.tileMode = view.getTileMode();
+
+    if (!view.getImageFormat()) {
+        result.error = "Unknown format ID " + std::to_string(view.getFormatId());
+        return result;
+    }
+
+    Bflim bflim;
+    bflim.parseImageInformation(view);
+    // The batch already keeps every core busy
+    bflim.setExecutor(runSerially);
+    bflim.setCache(cache);
+
+    result.success = bflim.decodeRGBA(view.getImageData(), view.getImageDataSize(), result.rgba, result.error);
+    if (!result.success) result.rgba.clear();
+    return result;
+}
+
+std::vector<BflimBatchResult> BflimBatch::run(const std::vector<BflimBatchInput>& inputs,
+                                              const BflimBatchCallback& onResult)
+{
+    std::vector<BflimBatchResult> results(inputs.size());
+    if (inputs.empty()) return results;
+
+    std::vector<size_t> costs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        costs[i] = estimateCost(inputs[i]);
+    }
+
+    std::vector<size_t> order(inputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+
+    const u32 workerCount = (u32)std::min<size_t>(mThreadCount, inputs.size());
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (u32 i = 0; i < workerCount; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        queues[i % workerCount]->items.push_back(order[i]);
+    }
+
+    auto worker = [&](size_t self) {
+        size_t item;
+        while (popLocal(*queues[self], item) || steal(queues, self, item)) {
+            BflimBatchResult result = process(inputs[item], mCache);
+            if (onResult) {
+                onResult(item, result);
+                result.rgba.clear();
+                result.rgba.shrink_to_fit();
+            }
+            results[item] = std::move(result);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (u32 i = 1; i < workerCount; i++) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include <types.h>
+#include <BflimCache.h>
+
+struct BflimBatchInput
+{
+    // Either a file path (memory-mapped while it is processed) or a caller buffer
+    std::string path;
+    const u8* data = nullptr;
+    size_t size = 0;
+
+    static BflimBatchInput fromFile(const std::string& path)
+    {
+        BflimBatchInput input;
+        input.path = path;
+        return input;
+    }
+
+    static BflimBatchInput fromMemory(const u8* data, size_t size, const std::string& name = std::string())
+    {
+        BflimBatchInput input;
+        input.path = name;
+        input.data = data;
+        input.size = size;
+        return input;
+    }
+};
+
+struct BflimBatchResult
+{
+    bool success = false;
+    std::string error;
+    u16 width = 0;
+    u16 height = 0;
+    u8 formatId = 0;
+    u8 tileMode = 0;
+    std::vector<u8> rgba;
+};
+
+// Called on a worker thread as soon as an item is done. When a callback is set,
+// the RGBA data is released after it returns instead of being kept in the results.
+using BflimBatchCallback = std::function<void(size_t index, BflimBatchResult& result)>;
+
+// Parses, deswizzles and decodes many BFLIMs on all cores. Items are dealt to
+// per-worker queues largest first, and idle workers steal from the others, so
+// one big atlas only occupies the worker that is decoding it.
+class BflimBatch
+{
+public:
+    // 0 threads = std::thread::hardware_concurrency()
+    explicit BflimBatch(u32 threadCount = 0);
+
+    std::vector<BflimBatchResult> run(const std::vector<BflimBatchInput>& inputs,
+                                      const BflimBatchCallback& onResult = nullptr);
+
+    // Duplicate textures are decoded once and copied from the cache afterwards
+    void setCache(BflimCache* cache)
+    {
+        mCache = cache;
+    }
+
+    static BflimBatchResult process(const BflimBatchInput& input, BflimCache* cache = nullptr);
+
+private:
+    u32 mThreadCount;
+    BflimCache* mCache = nullptr;
+};
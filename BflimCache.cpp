@@ -0,0 +1,177 @@
+#include <BflimCache.h>
+#include <cstring>
+
+namespace
+{
+    constexpr u64 Prime1 = 0x9E3779B185EBCA87ull;
+    constexpr u64 Prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr u64 Prime3 = 0x165667B19E3779F9ull;
+    constexpr u64 Prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr u64 Prime5 = 0x27D4EB2F165667C5ull;
+
+    inline u64 rotl(u64 value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline u64 read64(const u8* data)
+    {
+        u64 value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline u64 round(u64 acc, u64 input)
+    {
+        return rotl(acc + input * Prime2, 31) * Prime1;
+    }
+
+    inline u64 mergeRound(u64 acc, u64 lane)
+    {
+        return (acc ^ round(0, lane)) * Prime1 + Prime4;
+    }
+}
+
+// xxHash64-style: four independent lanes over 32-byte stripes keep it memory bound
+u64 BflimCache::hash(const u8* data, size_t size)
+{
+    const u8* p = data;
+    const u8* end = data + size;
+    u64 h;
+
+    if (size >= 32) {
+        u64 v1 = Prime1 + Prime2;
+        u64 v2 = Prime2;
+        u64 v3 = 0;
+        u64 v4 = 0 - Prime1;
+
+        for (; p + 32 <= end; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else {
+        h = Prime5;
+    }
+
+    h += (u64)size;
+
+    for (; p + 8 <= end; p += 8) {
+        h = rotl(h ^ round(0, read64(p)), 27) * Prime1 + Prime4;
+    }
+    for (; p < end; p++) {
+        h = rotl(h ^ (*p * Prime5), 11) * Prime1;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+BflimCacheKey BflimCache::makeKey(u16 width, u16 height, u8 formatId, u8 tileMode, u8 swizzle,
+                                  const u8* data, size_t size, u8 platform, u8 pixelFormat)
+{
+    BflimCacheKey key;
+    key.hash = hash(data, size);
+    key.size = size;
+    key.width = width;
+    key.height = height;
+    key.formatId = formatId;
+    key.tileMode = tileMode;
+    key.swizzle = swizzle;
+    key.platform = platform;
+    key.pixelFormat = pixelFormat;
+    return key;
+}
+
+BflimCache::BflimCache(size_t budgetBytes)
+    : mBudget(budgetBytes)
+{
+}
+
+BflimCache::Image BflimCache::find(const BflimCacheKey& key)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        mMisses++;
+        return nullptr;
+    }
+
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    mHits++;
+    return it->second->image;
+}
+
+BflimCache::Image BflimCache::insert(const BflimCacheKey& key, std::vector<u8> rgba)
+{
+    Image image = std::make_shared<const std::vector<u8>>(std::move(rgba));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (image->size() > mBudget) return image;
+
+    auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+        // Another thread decoded the same texture first, keep its copy
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return it->second->image;
+    }
+
+    mEntries.push_front(Entry{key, image});
+    mIndex[key] = mEntries.begin();
+    mBytes += image->size();
+    evict();
+    return image;
+}
+
+void BflimCache::setBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBudget = budgetBytes;
+    evict();
+}
+
+void BflimCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mIndex.clear();
+    mBytes = 0;
+}
+
+BflimCacheStats BflimCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    BflimCacheStats stats;
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    stats.entries = mEntries.size();
+    stats.bytes = mBytes;
+    stats.budget = mBudget;
+    return stats;
+}
+
+void BflimCache::evict()
+{
+    while (mBytes > mBudget && !mEntries.empty()) {
+        const Entry& oldest = mEntries.back();
+        mBytes -= oldest.image->size();
+        mIndex.erase(oldest.key);
+        mEntries.pop_back();
+        mEvictions++;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <types.h>
+
+// Identifies a decoded texture by its imag header fields plus a 64-bit hash of the
+// payload, so identical BFLIMs from different archives share one entry.
+struct BflimCacheKey
+{
+    u64 hash = 0;
+    size_t size = 0;
+    u16 width = 0;
+    u16 height = 0;
+    u8 formatId = 0;
+    u8 tileMode = 0;
+    u8 swizzle = 0;
+    u8 platform = 0;
+    // BflimPixelFormat of the decoded image
+    u8 pixelFormat = 0;
+
+    bool operator==(const BflimCacheKey& other) const
+    {
+        return hash == other.hash && size == other.size && width == other.width && height == other.height &&
+               formatId == other.formatId && tileMode == other.tileMode && swizzle == other.swizzle &&
+               platform == other.platform && pixelFormat == other.pixelFormat;
+    }
+};
+
+struct BflimCacheStats
+{
+    u64 hits = 0;
+    u64 misses = 0;
+    u64 evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget = 0;
+};
+
+// Thread-safe LRU cache of decoded images, bounded by a byte budget.
+// Attach it with Bflim::setCache(); one cache can be shared by many Bflim objects.
+class BflimCache
+{
+public:
+    using Image = std::shared_ptr<const std::vector<u8>>;
+
+    explicit BflimCache(size_t budgetBytes = 256 * 1024 * 1024);
+
+    BflimCache(const BflimCache&) = delete;
+    BflimCache& operator=(const BflimCache&) = delete;
+
+    static BflimCacheKey makeKey(u16 width, u16 height, u8 formatId, u8 tileMode, u8 swizzle,
+                                 const u8* data, size_t size, u8 platform = 0, u8 pixelFormat = 0);
+    static u64 hash(const u8* data, size_t size);
+
+    // Returns nullptr (and counts a miss) when the key is not cached
+    Image find(const BflimCacheKey& key);
+    // Images larger than the whole budget are not stored
+    Image insert(const BflimCacheKey& key, std::vector<u8> rgba);
+
+    void setBudget(size_t budgetBytes);
+    void clear();
+    BflimCacheStats getStats() const;
+
+private:
+    struct KeyHasher
+    {
+        size_t operator()(const BflimCacheKey& key) const
+        {
+            return (size_t)key.hash;
+        }
+    };
+
+    struct Entry
+    {
+        BflimCacheKey key;
+        Image image;
+    };
+
+    void evict();
+
+    mutable std::mutex mMutex;
+    std::list<Entry> mEntries; // most recently used first
+    std::unordered_map<BflimCacheKey, std::list<Entry>::iterator, KeyHasher> mIndex;
+    size_t mBudget;
+    size_t mBytes = 0;
+    u64 mHits = 0;
+    u64 mMisses = 0;
+    u64 mEvictions = 0;
+};
@@ -0,0 +1,123 @@
+#include <BflimColor.h>
+#include <BflimFormats.h>
+#include <BflimSimd.h>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Indexed by channel * 256 + value, alpha always takes the UNORM quarter
+    struct Tables
+    {
+        u8 linear8[256];
+        float unormFloat[1024];
+        float srgbFloat[1024];
+        u16 unormHalf[1025];
+        u16 srgbHalf[1025];
+    };
+
+    Tables buildTables()
+    {
+        Tables tables = {};
+        for (u32 value = 0; value < 256; value++) {
+            const float unorm = value / 255.0f;
+            const float linear = BflimColor::srgbToLinear(unorm);
+            tables.linear8[value] = (u8)(linear * 255.0f + 0.5f);
+
+            for (u32 channel = 0; channel < 4; channel++) {
+                const u32 index = channel * 256 + value;
+                tables.unormFloat[index] = unorm;
+                tables.srgbFloat[index] = channel == 3 ? unorm : linear;
+                tables.unormHalf[index] = BflimColor::floatToHalf(tables.unormFloat[index]);
+                tables.srgbHalf[index] = BflimColor::floatToHalf(tables.srgbFloat[index]);
+            }
+        }
+        return tables;
+    }
+
+    const Tables& getTables()
+    {
+        static const Tables tables = buildTables();
+        return tables;
+    }
+}
+
+u32 BflimColor::getBytesPerPixel(BflimPixelFormat format)
+{
+    switch (format) {
+        case BflimPixelFormat::RGBA16F: return 8;
+        case BflimPixelFormat::RGBA32F: return 16;
+        default: return 4;
+    }
+}
+
+bool BflimColor::isSrgbFormat(u8 formatId)
+{
+    const Format* format = BflimConstants::findFormat(formatId);
+    if (!format) return false;
+
+    switch (format->mGX2Format) {
+        case GX2_SURFACE_FORMAT_SRGB_RGBA8:
+        case GX2_SURFACE_FORMAT_SRGB_BC1:
+        case GX2_SURFACE_FORMAT_SRGB_BC2:
+        case GX2_SURFACE_FORMAT_SRGB_BC3:
+            return true;
+        default:
+            return false;
+    }
+}
+
+float BflimColor::srgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+u16 BflimColor::floatToHalf(float value)
+{
+    u32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const u16 sign = (u16)((bits >> 16) & 0x8000);
+    const u32 magnitude = bits & 0x7FFFFFFF;
+
+    // Would round past 65504, the largest finite half
+    if (magnitude >= 0x477FF000) return sign | 0x7BFF;
+
+    // Below 2^-14 the half is subnormal, its unit is 2^-24
+    if (magnitude < 0x38800000) {
+        return sign | (u16)std::nearbyint(std::fabs(value) * 16777216.0f);
+    }
+
+    const u32 rounded = magnitude + 0x0FFF + ((magnitude >> 13) & 1);
+    return sign | (u16)((rounded - 0x38000000) >> 13);
+}
+
+void BflimColor::convert(const u8* rgba, u8* output, size_t count, BflimPixelFormat format, bool srgb)
+{
+    const Tables& tables = getTables();
+
+    switch (format) {
+        case BflimPixelFormat::RGBA8Linear:
+            if (srgb) {
+                for (size_t i = 0; i < count * 4; i += 4) {
+                    output[i + 0] = tables.linear8[rgba[i + 0]];
+                    output[i + 1] = tables.linear8[rgba[i + 1]];
+                    output[i + 2] = tables.linear8[rgba[i + 2]];
+                    output[i + 3] = rgba[i + 3];
+                }
+                break;
+            }
+            // UNORM data is linear already
+            [[fallthrough]];
+        case BflimPixelFormat::RGBA8:
+            if (output != rgba) std::memcpy(output, rgba, count * 4);
+            break;
+        case BflimPixelFormat::RGBA16F:
+            BflimSimd::get().lookupHalf(rgba, reinterpret_cast<u16*>(output), count,
+                                        srgb ? tables.srgbHalf : tables.unormHalf);
+            break;
+        case BflimPixelFormat::RGBA32F:
+            BflimSimd::get().lookupFloat(rgba, reinterpret_cast<float*>(output), count,
+                                         srgb ? tables.srgbFloat : tables.unormFloat);
+            break;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <types.h>
+
+// Pixel layout of decoded images
+enum class BflimPixelFormat : u8
+{
+    RGBA8,          // stored values, sRGB formats stay sRGB encoded
+    RGBA8Linear,    // sRGB formats converted to linear light, 8 bits per channel
+    RGBA16F,        // half floats, linear light
+    RGBA32F         // floats, linear light
+};
+
+struct BflimDecodeOptions
+{
+    BflimPixelFormat pixelFormat = BflimPixelFormat::RGBA8;
+};
+
+// sRGB/linear conversion of decoded RGBA8 pixels through precomputed tables.
+// Only the color channels of sRGB formats (0x14-0x17) are linearized, alpha and
+// UNORM formats are just normalized.
+namespace BflimColor
+{
+    u32 getBytesPerPixel(BflimPixelFormat format);
+    bool isSrgbFormat(u8 formatId);
+
+    // The sRGB decode curve (IEC 61966-2-1), value in [0, 1]
+    float srgbToLinear(float value);
+    // Round to nearest even, no infinities/NaN handling beyond clamping to the half range
+    u16 floatToHalf(float value);
+
+    // count RGBA8 pixels to format. output may be rgba for RGBA8/RGBA8Linear.
+    void convert(const u8* rgba, u8* output, size_t count, BflimPixelFormat format, bool srgb);
+}
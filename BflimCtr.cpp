@@ -0,0 +1,380 @@
+#include <BflimCtr.h>
+#include <BflimDecoders.h>
+#include <BflimFormats.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    struct MortonTable
+    {
+        // Morton index inside a tile -> y * 8 + x
+        u8 linear[64];
+    };
+
+    constexpr MortonTable buildMortonTable()
+    {
+        MortonTable table = {};
+        for (u32 i = 0; i < 64; i++) {
+            u32 x = (i & 1) | ((i >> 1) & 2) | ((i >> 2) & 4);
+            u32 y = ((i >> 1) & 1) | ((i >> 2) & 2) | ((i >> 3) & 4);
+            table.linear[i] = (u8)(y * 8 + x);
+        }
+        return table;
+    }
+
+    constexpr MortonTable Morton = buildMortonTable();
+
+    inline u32 read16LE(const u8* data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+
+    inline void write16LE(u8* data, u32 value)
+    {
+        data[0] = (u8)value;
+        data[1] = (u8)(value >> 8);
+    }
+
+    inline u8 expand4(u32 value)
+    {
+        return (u8)(value * 17);
+    }
+
+    inline u8 expand5(u32 value)
+    {
+        return (u8)((value << 3) | (value >> 2));
+    }
+
+    inline u8 expand6(u32 value)
+    {
+        return (u8)((value << 2) | (value >> 4));
+    }
+
+    inline u8 luminance(const u8* rgba)
+    {
+        return (u8)((rgba[0] * 77 + rgba[1] * 150 + rgba[2] * 29) >> 8);
+    }
+
+    inline void setRGBA(u8* dst, u8 r, u8 g, u8 b, u8 a)
+    {
+        dst[0] = r;
+        dst[1] = g;
+        dst[2] = b;
+        dst[3] = a;
+    }
+
+    // The PICA200 packs the first named component into the most significant bits.
+    // Alpha-only formats are shown as grey, like A8 and BC4A on the Wii U.
+    template <u8 FormatId> struct CtrPixel;
+
+    template <> struct CtrPixel<0x00> // L8
+    {
+        static constexpr u32 Bytes = 1;
+        static void decode(const u8* src, u8* dst) { setRGBA(dst, src[0], src[0], src[0], 255); }
+        static void encode(const u8* src, u8* dst) { dst[0] = luminance(src); }
+    };
+
+    template <> struct CtrPixel<0x01> // A8
+    {
+        static constexpr u32 Bytes = 1;
+        static void decode(const u8* src, u8* dst) { setRGBA(dst, src[0], src[0], src[0], 255); }
+        static void encode(const u8* src, u8* dst) { dst[0] = src[0]; }
+    };
+
+    template <> struct CtrPixel<0x02> // LA4
+    {
+        static constexpr u32 Bytes = 1;
+        static void decode(const u8* src, u8* dst)
+        {
+            u8 l = expand4(src[0] >> 4);
+            setRGBA(dst, l, l, l, expand4(src[0] & 0xF));
+        }
+        static void encode(const u8* src, u8* dst) { dst[0] = (u8)((luminance(src) >> 4) << 4 | (src[3] >> 4)); }
+    };
+
+    template <> struct CtrPixel<0x03> // LA8
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst) { setRGBA(dst, src[1], src[1], src[1], src[0]); }
+        static void encode(const u8* src, u8* dst)
+        {
+            dst[0] = src[3];
+            dst[1] = luminance(src);
+        }
+    };
+
+    template <> struct CtrPixel<0x04> // HILO8
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst) { setRGBA(dst, src[1], src[0], 0, 255); }
+        static void encode(const u8* src, u8* dst)
+        {
+            dst[0] = src[1];
+            dst[1] = src[0];
+        }
+    };
+
+    template <> struct CtrPixel<0x05> // RGB565
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read16LE(src);
+            setRGBA(dst, expand5(value >> 11), expand6((value >> 5) & 0x3F), expand5(value & 0x1F), 255);
+        }
+        static void encode(const u8* src, u8* dst)
+        {
+            write16LE(dst, ((src[0] >> 3) << 11) | ((src[1] >> 2) << 5) | (src[2] >> 3));
+        }
+    };
+
+    template <> struct CtrPixel<0x06> // RGB8
+    {
+        static constexpr u32 Bytes = 3;
+        static void decode(const u8* src, u8* dst) { setRGBA(dst, src[2], src[1], src[0], 255); }
+        static void encode(const u8* src, u8* dst)
+        {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+        }
+    };
+
+    template <> struct CtrPixel<0x07> // RGB5A1
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read16LE(src);
+            setRGBA(dst, expand5(value >> 11), expand5((value >> 6) & 0x1F), expand5((value >> 1) & 0x1F),
+                    (value & 1) ? 255 : 0);
+        }
+        static void encode(const u8* src, u8* dst)
+        {
+            write16LE(dst, ((src[0] >> 3) << 11) | ((src[1] >> 3) << 6) | ((src[2] >> 3) << 1) | (src[3] >> 7));
+        }
+    };
+
+    template <> struct CtrPixel<0x08> // RGBA4
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read16LE(src);
+            setRGBA(dst, expand4(value >> 12), expand4((value >> 8) & 0xF), expand4((value >> 4) & 0xF),
+                    expand4(value & 0xF));
+        }
+        static void encode(const u8* src, u8* dst)
+        {
+            write16LE(dst, ((src[0] >> 4) << 12) | ((src[1] >> 4) << 8) | ((src[2] >> 4) << 4) | (src[3] >> 4));
+        }
+    };
+
+    template <> struct CtrPixel<0x09> // RGBA8, stored A B G R
+    {
+        static constexpr u32 Bytes = 4;
+        static void decode(const u8* src, u8* dst) { setRGBA(dst, src[3], src[2], src[1], src[0]); }
+        static void encode(const u8* src, u8* dst) { setRGBA(dst, src[3], src[2], src[1], src[0]); }
+    };
+
+    // A tile is decoded to / encoded from 8x8 RGBA pixels in memory row order
+    using TileDecoder = void (*)(const u8* tile, u8* rgba);
+    using TileEncoder = void (*)(const u8* rgba, u8* tile);
+
+    template <u8 FormatId>
+    void decodeTile(const u8* tile, u8* rgba)
+    {
+        for (u32 i = 0; i < 64; i++) {
+            CtrPixel<FormatId>::decode(tile + i * CtrPixel<FormatId>::Bytes, rgba + Morton.linear[i] * 4);
+        }
+    }
+
+    template <u8 FormatId>
+    void encodeTile(const u8* rgba, u8* tile)
+    {
+        for (u32 i = 0; i < 64; i++) {
+            CtrPixel<FormatId>::encode(rgba + Morton.linear[i] * 4, tile + i * CtrPixel<FormatId>::Bytes);
+        }
+    }
+
+    // L4 and A4, two pixels per byte, low nibble first
+    void decodeNibbleTile(const u8* tile, u8* rgba)
+    {
+        for (u32 i = 0; i < 64; i++) {
+            u8 value = expand4((tile[i / 2] >> ((i & 1) * 4)) & 0xF);
+            setRGBA(rgba + Morton.linear[i] * 4, value, value, value, 255);
+        }
+    }
+
+    void encodeNibbleTile(const u8* rgba, u8* tile)
+    {
+        std::memset(tile, 0, 32);
+        for (u32 i = 0; i < 64; i++) {
+            tile[i / 2] |= (luminance(rgba + Morton.linear[i] * 4) >> 4) << ((i & 1) * 4);
+        }
+    }
+
+    template <u8 FormatId>
+    void decodeETC1Tile(const u8* tile, u8* rgba)
+    {
+        const BflimDecoders::Kernel kernel = BflimDecoders::get(FormatId);
+        const u32 blockBytes = FormatId == 0x0B ? 16 : 8;
+        u8 block[64];
+
+        for (u32 i = 0; i < 4; i++) {
+            kernel(tile + i * blockBytes, block, 4, 4);
+            u32 x = (i & 1) * 4;
+            u32 y = (i >> 1) * 4;
+            for (u32 row = 0; row < 4; row++) {
+                std::memcpy(rgba + ((y + row) * 8 + x) * 4, block + row * 16, 16);
+            }
+        }
+    }
+
+    struct CtrFormat
+    {
+        u8 mCtrFormat;
+        u8 mBitsPerPixel;
+        TileDecoder mDecode;
+        TileEncoder mEncode;
+    };
+
+    // Indexed by SupportedFormats ID, formats without a 3DS equivalent have no decoder
+    constexpr CtrFormat CtrFormats[] = {
+        { 0x00, 8,  decodeTile<0x00>, encodeTile<0x00> },   // L8
+        { 0x01, 8,  decodeTile<0x01>, encodeTile<0x01> },   // A8
+        { 0x02, 8,  decodeTile<0x02>, encodeTile<0x02> },   // LA4
+        { 0x03, 16, decodeTile<0x03>, encodeTile<0x03> },   // LA8
+        { 0x04, 16, decodeTile<0x04>, encodeTile<0x04> },   // HILO8
+        { 0x05, 16, decodeTile<0x05>, encodeTile<0x05> },   // RGB565
+        { 0x06, 24, decodeTile<0x06>, encodeTile<0x06> },   // RGB8
+        { 0x07, 16, decodeTile<0x07>, encodeTile<0x07> },   // RGB5A1
+        { 0x08, 16, decodeTile<0x08>, encodeTile<0x08> },   // RGBA4
+        { 0x09, 32, decodeTile<0x09>, encodeTile<0x09> },   // RGBA8
+        { 0x0A, 4,  decodeETC1Tile<0x0A>, nullptr },        // ETC1
+        { 0x0B, 8,  decodeETC1Tile<0x0B>, nullptr },        // ETC1A4
+        { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr },
+        { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr },
+        { 0x0C, 4,  decodeNibbleTile, encodeNibbleTile },   // L4
+        { 0x0D, 4,  decodeNibbleTile, encodeNibbleTile },   // A4
+        { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr },
+        { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr }, { 0xFF, 0, nullptr, nullptr },
+    };
+
+    static_assert(std::size(CtrFormats) == std::size(BflimConstants::SupportedFormats),
+                  "CtrFormats must be indexed by format ID");
+
+    const CtrFormat* findCtrFormat(u8 formatId)
+    {
+        if (formatId >= std::size(CtrFormats) || !CtrFormats[formatId].mDecode) return nullptr;
+        return &CtrFormats[formatId];
+    }
+}
+
+bool BflimCtr::toFormatId(u8 ctrFormat, u8& formatId)
+{
+    for (size_t i = 0; i < std::size(CtrFormats); i++) {
+        if (CtrFormats[i].mDecode && CtrFormats[i].mCtrFormat == ctrFormat) {
+            formatId = (u8)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+u8 BflimCtr::toCtrFormat(u8 formatId)
+{
+    const CtrFormat* format = findCtrFormat(formatId);
+    return format ? format->mCtrFormat : 0xFF;
+}
+
+bool BflimCtr::isDecodable(u8 formatId)
+{
+    return findCtrFormat(formatId) != nullptr;
+}
+
+bool BflimCtr::isEncodable(u8 formatId)
+{
+    const CtrFormat* format = findCtrFormat(formatId);
+    return format && format->mEncode;
+}
+
+u32 BflimCtr::getBitsPerPixel(u8 formatId)
+{
+    const CtrFormat* format = findCtrFormat(formatId);
+    return format ? format->mBitsPerPixel : 0;
+}
+
+u32 BflimCtr::getSurfaceDimension(u32 dimension)
+{
+    u32 surface = 8;
+    while (surface < dimension) surface *= 2;
+    return surface;
+}
+
+size_t BflimCtr::getImageSize(u8 formatId, u32 width, u32 height)
+{
+    return (size_t)getSurfaceDimension(width) * getSurfaceDimension(height) * getBitsPerPixel(formatId) / 8;
+}
+
+bool BflimCtr::decode(const u8* data, size_t size, u8 formatId, u32 width, u32 height, u8* rgba)
+{
+    const CtrFormat* format = findCtrFormat(formatId);
+    if (!format || size < getImageSize(formatId, width, height)) return false;
+
+    const u32 surfaceWidth = getSurfaceDimension(width);
+    const u32 surfaceHeight = getSurfaceDimension(height);
+    const u32 tileBytes = format->mBitsPerPixel * 8;
+    const u32 tilesX = surfaceWidth / 8;
+    const u32 usedTilesX = (width + 7) / 8;
+    // Rows are stored bottom-up, so the image sits in the last height rows of the surface
+    const u32 firstRow = surfaceHeight - height;
+    u8 tile[64 * 4];
+
+    for (u32 ty = firstRow / 8; ty < surfaceHeight / 8; ty++) {
+        for (u32 tx = 0; tx < usedTilesX; tx++) {
+            format->mDecode(data + ((size_t)ty * tilesX + tx) * tileBytes, tile);
+
+            u32 x = tx * 8;
+            u32 columns = std::min(8u, width - x);
+            for (u32 row = 0; row < 8; row++) {
+                u32 surfaceRow = ty * 8 + row;
+                if (surfaceRow < firstRow) continue;
+                u32 y = surfaceHeight - 1 - surfaceRow;
+                std::memcpy(rgba + ((size_t)y * width + x) * 4, tile + row * 32, columns * 4);
+            }
+        }
+    }
+    return true;
+}
+
+bool BflimCtr::encode(const u8* rgba, u8 formatId, u32 width, u32 height, u8* data, size_t size)
+{
+    const CtrFormat* format = findCtrFormat(formatId);
+    if (!format || !format->mEncode || width == 0 || height == 0 || size < getImageSize(formatId, width, height)) {
+        return false;
+    }
+
+    const u32 surfaceWidth = getSurfaceDimension(width);
+    const u32 surfaceHeight = getSurfaceDimension(height);
+    const u32 tileBytes = format->mBitsPerPixel * 8;
+    const u32 tilesX = surfaceWidth / 8;
+    u8 tile[64 * 4];
+
+    for (u32 ty = 0; ty < surfaceHeight / 8; ty++) {
+        for (u32 tx = 0; tx < tilesX; tx++) {
+            for (u32 row = 0; row < 8; row++) {
+                u32 surfaceRow = ty * 8 + row;
+                u32 y = surfaceRow + height >= surfaceHeight ? surfaceHeight - 1 - surfaceRow : height - 1;
+                for (u32 column = 0; column < 8; column++) {
+                    u32 x = std::min(tx * 8 + column, width - 1);
+                    std::memcpy(tile + (row * 8 + column) * 4, rgba + ((size_t)y * width + x) * 4, 4);
+                }
+            }
+            format->mEncode(tile, data + ((size_t)ty * tilesX + tx) * tileBytes);
+        }
+    }
+    return true;
+}
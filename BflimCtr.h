@@ -0,0 +1,28 @@
+#pragma once
+#include <types.h>
+
+// 3DS (CTR) texture layout. The surface is padded to powers of two (at least one
+// 8x8 tile), split into 8x8 tiles stored row by row, pixels inside a tile are in
+// Morton (Z) order, and rows are stored bottom-up. ETC1 tiles hold 2x2 blocks in Z order.
+// Format IDs are BflimConstants::SupportedFormats IDs, not the raw 3DS format byte.
+namespace BflimCtr
+{
+    // 3DS imag format byte -> SupportedFormats ID, false for unknown values
+    bool toFormatId(u8 ctrFormat, u8& formatId);
+    // SupportedFormats ID -> 3DS imag format byte, 0xFF if the 3DS has no such format
+    u8 toCtrFormat(u8 formatId);
+
+    bool isDecodable(u8 formatId);
+    // ETC1/ETC1A4 are decode only
+    bool isEncodable(u8 formatId);
+
+    // Bits per pixel as the 3DS stores them (RGB8 is 24-bit)
+    u32 getBitsPerPixel(u8 formatId);
+    u32 getSurfaceDimension(u32 dimension);
+    size_t getImageSize(u8 formatId, u32 width, u32 height);
+
+    // Tiled data -> width x height RGBA8, top row first
+    bool decode(const u8* data, size_t size, u8 formatId, u32 width, u32 height, u8* rgba);
+    // width x height RGBA8 -> tiled data (getImageSize() bytes), padding repeats the edge pixels
+    bool encode(const u8* rgba, u8 formatId, u32 width, u32 height, u8* data, size_t size);
+}
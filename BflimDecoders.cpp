@@ -0,0 +1,307 @@
+#include <BflimDecoders.h>
+#include <BflimFormats.h>
+#include <BflimSimd.h>
+#include <ninTexUtils/bcn/decompress.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    inline u32 read16LE(const u8* data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+
+    inline u32 read32LE(const u8* data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((u32)data[3] << 24);
+    }
+
+    inline u64 read64LE(const u8* data)
+    {
+        return read32LE(data) | ((u64)read32LE(data + 4) << 32);
+    }
+
+    inline u8 expand4(u32 value)
+    {
+        return (u8)(value * 17);
+    }
+
+    inline u8 expand5(u32 value)
+    {
+        return (u8)((value << 3) | (value >> 2));
+    }
+
+    inline u8 expand6(u32 value)
+    {
+        return (u8)((value << 2) | (value >> 4));
+    }
+
+    inline void setRGBA(u8* dst, u8 r, u8 g, u8 b, u8 a)
+    {
+        dst[0] = r;
+        dst[1] = g;
+        dst[2] = b;
+        dst[3] = a;
+    }
+
+    // GX2 stores components from the least significant bit up, words are little endian
+    template <u8 FormatId> struct Pixel;
+
+    template <> struct Pixel<0x02> // LA4 (RG4)
+    {
+        static constexpr u32 Bytes = 1;
+        static void decode(const u8* src, u8* dst)
+        {
+            u8 l = expand4(src[0] & 0xF);
+            setRGBA(dst, l, l, l, expand4(src[0] >> 4));
+        }
+    };
+
+    template <> struct Pixel<0x04> // HILO8 (RG8)
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            setRGBA(dst, src[0], src[1], 0, 255);
+        }
+    };
+
+    template <> struct Pixel<0x05> // RGB565
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read16LE(src);
+            setRGBA(dst, expand5(value & 0x1F), expand6((value >> 5) & 0x3F), expand5(value >> 11), 255);
+        }
+    };
+
+    template <> struct Pixel<0x06> // RGBX8
+    {
+        static constexpr u32 Bytes = 4;
+        static void decode(const u8* src, u8* dst)
+        {
+            setRGBA(dst, src[0], src[1], src[2], 255);
+        }
+    };
+
+    template <> struct Pixel<0x07> // RGB5A1
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read16LE(src);
+            setRGBA(dst, expand5(value & 0x1F), expand5((value >> 5) & 0x1F), expand5((value >> 10) & 0x1F),
+                    (value >> 15) ? 255 : 0);
+        }
+    };
+
+    template <> struct Pixel<0x08> // RGBA4
+    {
+        static constexpr u32 Bytes = 2;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read16LE(src);
+            setRGBA(dst, expand4(value & 0xF), expand4((value >> 4) & 0xF), expand4((value >> 8) & 0xF),
+                    expand4(value >> 12));
+        }
+    };
+
+    template <> struct Pixel<0x18> // RGB10A2
+    {
+        static constexpr u32 Bytes = 4;
+        static void decode(const u8* src, u8* dst)
+        {
+            u32 value = read32LE(src);
+            setRGBA(dst, (u8)((value >> 2) & 0xFF), (u8)((value >> 12) & 0xFF), (u8)((value >> 22) & 0xFF),
+                    (u8)((value >> 30) * 85));
+        }
+    };
+
+    template <u8 FormatId>
+    void decodePixels(const u8* data, u8* output, u32 width, u32 height)
+    {
+        const size_t count = (size_t)width * height;
+        for (size_t i = 0; i < count; i++) {
+            Pixel<FormatId>::decode(data + i * Pixel<FormatId>::Bytes, output + i * 4);
+        }
+    }
+
+    // L4 and A4, both shown as grey like A8 and BC4A
+    void decodeNibbles(const u8* data, u8* output, u32 width, u32 height)
+    {
+        const size_t count = (size_t)width * height;
+        for (size_t i = 0; i < count; i++) {
+            u8 value = expand4((data[i / 2] >> ((i & 1) * 4)) & 0xF);
+            setRGBA(output + i * 4, value, value, value, 255);
+        }
+    }
+
+    void decodeL8(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BflimSimd::get().expandL8(data, output, (size_t)width * height);
+    }
+
+    void decodeLA8(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BflimSimd::get().expandLA8(data, output, (size_t)width * height);
+    }
+
+    void decodeRGBA8(const u8* data, u8* output, u32 width, u32 height)
+    {
+        // Big Endian R G B A, already the output byte order
+        std::memcpy(output, data, (size_t)width * height * 4);
+    }
+
+    void decodeBC1(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BCn_DecompressBC1(width, height, data, output);
+    }
+
+    void decodeBC2(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BCn_DecompressBC2(width, height, data, output);
+    }
+
+    void decodeBC3(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BCn_DecompressBC3(width, height, data, output);
+    }
+
+    void decodeBC4(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BCn_DecompressBC4U(width, height, data, output);
+        BflimSimd::get().expandR(output, (size_t)width * height);  // G = B = R, A = voll
+    }
+
+    void decodeBC5(const u8* data, u8* output, u32 width, u32 height)
+    {
+        BCn_DecompressBC5U(width, height, data, output);
+        BflimSimd::get().expandR(output, (size_t)width * height);  // Grau = R
+    }
+
+    const int ETC1Modifiers[8][4] = {
+        { 2, 8, -2, -8 },       { 5, 17, -5, -17 },     { 9, 29, -9, -29 },     { 13, 42, -13, -42 },
+        { 18, 60, -18, -60 },   { 24, 80, -24, -80 },   { 33, 106, -33, -106 }, { 47, 183, -47, -183 },
+    };
+
+    inline u8 clampColor(int value)
+    {
+        return (u8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    // One ETC1 block (as a 64-bit value) into 16 RGBA pixels, pixel (x, y) at (y * 4 + x) * 4
+    void decodeETC1Block(u64 block, u8* pixels)
+    {
+        u32 high = (u32)(block >> 32);
+        u32 low = (u32)block;
+        bool flip = high & 1;
+        bool diff = (high >> 1) & 1;
+
+        int base[2][3];
+        if (diff) {
+            for (u32 c = 0; c < 3; c++) {
+                u32 shift = 27 - c * 8;
+                int value = (high >> shift) & 0x1F;
+                int delta = (high >> (shift - 3)) & 0x7;
+                if (delta >= 4) delta -= 8;
+                base[0][c] = expand5(value);
+                base[1][c] = expand5((value + delta) & 0x1F);
+            }
+        }
+        else {
+            for (u32 c = 0; c < 3; c++) {
+                u32 shift = 28 - c * 8;
+                base[0][c] = expand4((high >> shift) & 0xF);
+                base[1][c] = expand4((high >> (shift - 4)) & 0xF);
+            }
+        }
+
+        const int* tables[2] = { ETC1Modifiers[(high >> 5) & 7], ETC1Modifiers[(high >> 2) & 7] };
+
+        for (u32 x = 0; x < 4; x++) {
+            for (u32 y = 0; y < 4; y++) {
+                u32 i = x * 4 + y;
+                u32 index = ((low >> (i + 15)) & 2) | ((low >> i) & 1);
+                u32 subBlock = flip ? (y >= 2) : (x >= 2);
+                int modifier = tables[subBlock][index];
+
+                u8* pixel = pixels + (y * 4 + x) * 4;
+                setRGBA(pixel, clampColor(base[subBlock][0] + modifier), clampColor(base[subBlock][1] + modifier),
+                        clampColor(base[subBlock][2] + modifier), 255);
+            }
+        }
+    }
+
+    // 3DS stores ETC1 blocks as little endian 64-bit words, ETC1A4 puts 4-bit alpha in front
+    template <bool Alpha>
+    void decodeETC1(const u8* data, u8* output, u32 width, u32 height)
+    {
+        const u32 blocksX = (width + 3) / 4;
+        const u32 blocksY = (height + 3) / 4;
+        const u32 blockBytes = Alpha ? 16 : 8;
+        u8 pixels[64];
+
+        for (u32 by = 0; by < blocksY; by++) {
+            for (u32 bx = 0; bx < blocksX; bx++) {
+                const u8* block = data + ((size_t)by * blocksX + bx) * blockBytes;
+                decodeETC1Block(read64LE(block + (Alpha ? 8 : 0)), pixels);
+
+                if (Alpha) {
+                    u64 alpha = read64LE(block);
+                    for (u32 x = 0; x < 4; x++) {
+                        for (u32 y = 0; y < 4; y++) {
+                            pixels[(y * 4 + x) * 4 + 3] = expand4((alpha >> ((x * 4 + y) * 4)) & 0xF);
+                        }
+                    }
+                }
+
+                u32 rows = std::min(4u, height - by * 4);
+                u32 columns = std::min(4u, width - bx * 4);
+                for (u32 y = 0; y < rows; y++) {
+                    std::memcpy(output + ((size_t)(by * 4 + y) * width + bx * 4) * 4, pixels + y * 16, columns * 4);
+                }
+            }
+        }
+    }
+
+    // Indexed by format ID, same order as BflimConstants::SupportedFormats
+    constexpr BflimDecoders::Kernel Kernels[] = {
+        decodeL8,                 // 0x00 L8
+        decodeL8,                 // 0x01 A8, shown as grey
+        decodePixels<0x02>,       // 0x02 LA4
+        decodeLA8,                // 0x03 LA8
+        decodePixels<0x04>,       // 0x04 HILO8
+        decodePixels<0x05>,       // 0x05 RGB565
+        decodePixels<0x06>,       // 0x06 RGBX8
+        decodePixels<0x07>,       // 0x07 RGB5A1
+        decodePixels<0x08>,       // 0x08 RGBA4
+        decodeRGBA8,              // 0x09 RGBA8
+        decodeETC1<false>,        // 0x0A ETC1
+        decodeETC1<true>,         // 0x0B ETC1A4
+        decodeBC1,                // 0x0C BC1
+        decodeBC2,                // 0x0D BC2
+        decodeBC3,                // 0x0E BC3
+        decodeBC4,                // 0x0F BC4 L
+        decodeBC4,                // 0x10 BC4 A, shown as grey
+        decodeBC5,                // 0x11 BC5
+        decodeNibbles,            // 0x12 L4
+        decodeNibbles,            // 0x13 A4, shown as grey
+        decodeRGBA8,              // 0x14 RGBA8 sRGB
+        decodeBC1,                // 0x15 BC1 sRGB
+        decodeBC2,                // 0x16 BC2 sRGB
+        decodeBC3,                // 0x17 BC3 sRGB
+        decodePixels<0x18>,       // 0x18 RGB10A2
+        decodePixels<0x05>,       // 0x19 RGB565 indirect
+    };
+
+    static_assert(std::size(Kernels) == std::size(BflimConstants::SupportedFormats),
+                  "Every supported format needs a decoder");
+}
+
+BflimDecoders::Kernel BflimDecoders::get(u8 formatId)
+{
+    return formatId < std::size(Kernels) ? Kernels[formatId] : nullptr;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <types.h>
+
+// Per-format pixel kernels, one table entry per BflimConstants::SupportedFormats ID.
+// Input is packed elements in row-major order: pixels for uncompressed formats
+// (two per byte, low nibble first, for 4-bit ones) or 4x4 blocks for BCn/ETC1.
+namespace BflimDecoders
+{
+    // Decodes width x height pixels into RGBA8 (width * height * 4 bytes)
+    using Kernel = void (*)(const u8* data, u8* output, u32 width, u32 height);
+
+    // nullptr for unknown format IDs
+    Kernel get(u8 formatId);
+}
@@ -0,0 +1,36 @@
+#include <BflimEditor.h>
+
+BflimEditor::BflimEditor(const BflimTexture& texture)
+{
+    mBflim.parseBinary(texture.getData());
+}
+
+bool BflimEditor::replaceWithRGBA(const std::vector<u8>& rgbaData)
+{
+    return mBflim.replaceWithRGBA(rgbaData);
+}
+
+bool BflimEditor::replaceRegionWithRGBA(const std::vector<u8>& rgbaData, u32 x, u32 y, u32 width, u32 height)
+{
+    return mBflim.replaceRegionWithRGBA(rgbaData, x, y, width, height);
+}
+
+bool BflimEditor::replaceChangedRGBA(const std::vector<u8>& previousRgba, const std::vector<u8>& rgbaData)
+{
+    return mBflim.replaceChangedRGBA(previousRgba, rgbaData);
+}
+
+bool BflimEditor::rebuildWithRGBA(const BflimImageDesc& desc, const std::vector<u8>& rgbaData)
+{
+    return mBflim.rebuildWithRGBA(desc, rgbaData);
+}
+
+bool BflimEditor::retile(u8 targetTileMode, u8 targetSwizzle)
+{
+    return mBflim.retile(targetTileMode, targetSwizzle);
+}
+
+BflimTexture::Ptr BflimEditor::createTexture(std::string& error, BflimCache* cache) const
+{
+    return BflimTexture::create(mBflim.getRawData(), error, cache);
+}
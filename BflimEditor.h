@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <types.h>
+#include <Bflim.h>
+#include <BflimTexture.h>
+
+// Mutable working copy of a texture. Edits only touch the editor's own copy of the
+// file; createTexture() publishes the current state as a new immutable BflimTexture,
+// so textures other threads hold never change underneath them.
+class BflimEditor
+{
+public:
+    explicit BflimEditor(const BflimTexture& texture);
+
+    // Quality tier and optional error metrics of the replace calls
+    void setEncodeOptions(const BflimEncodeOptions& options)
+    {
+        mBflim.setEncodeOptions(options);
+    }
+
+    const BflimEncodeMetrics& getEncodeMetrics() const
+    {
+        return mBflim.getEncodeMetrics();
+    }
+
+    void setExecutor(BflimExecutor executor)
+    {
+        mBflim.setExecutor(std::move(executor));
+    }
+
+    bool replaceWithRGBA(const std::vector<u8>& rgbaData);
+    bool replaceRegionWithRGBA(const std::vector<u8>& rgbaData, u32 x, u32 y, u32 width, u32 height);
+    bool replaceChangedRGBA(const std::vector<u8>& previousRgba, const std::vector<u8>& rgbaData);
+    bool rebuildWithRGBA(const BflimImageDesc& desc, const std::vector<u8>& rgbaData);
+    bool retile(u8 targetTileMode, u8 targetSwizzle);
+
+    // The edited file
+    const std::vector<u8>& getData() const
+    {
+        return mBflim.getRawData();
+    }
+
+    // Copies the edited file into a new texture, the editor can keep going afterwards
+    BflimTexture::Ptr createTexture(std::string& error, BflimCache* cache = nullptr) const;
+
+private:
+    Bflim mBflim;
+};
@@ -0,0 +1,476 @@
+#include <BflimEncoders.h>
+#include <BflimFormats.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+namespace
+{
+    // Older stb_dxt versions build their tables lazily on the first call
+    void initStbDxt()
+    {
+        static std::once_flag stbInit;
+        std::call_once(stbInit, [] {
+            u8 pixels[64] = {};
+            u8 block[16];
+            stb_compress_dxt_block(block, pixels, 1, STB_DXT_NORMAL);
+        });
+    }
+
+    int stbMode(BflimEncodeQuality quality)
+    {
+        return quality == BflimEncodeQuality::High ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL;
+    }
+
+    inline u8 luminance(const u8* rgba)
+    {
+        return (u8)((rgba[0] * 77 + rgba[1] * 150 + rgba[2] * 29) >> 8);
+    }
+
+    inline u32 square(int value)
+    {
+        return (u32)(value * value);
+    }
+
+    inline u16 read16LE(const u8* data)
+    {
+        return (u16)(data[0] | (data[1] << 8));
+    }
+
+    inline void write16LE(u8* data, u32 value)
+    {
+        data[0] = (u8)value;
+        data[1] = (u8)(value >> 8);
+    }
+
+    // ---- Color blocks (BC1, and the color half of BC2/BC3) ----
+
+    inline u16 packRGB565(const u8* rgb)
+    {
+        return (u16)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+    }
+
+    inline void unpackRGB565(u16 color, u8* rgb)
+    {
+        u32 r = (color >> 11) & 0x1F;
+        u32 g = (color >> 5) & 0x3F;
+        u32 b = color & 0x1F;
+        rgb[0] = (u8)((r << 3) | (r >> 2));
+        rgb[1] = (u8)((g << 2) | (g >> 4));
+        rgb[2] = (u8)((b << 3) | (b >> 2));
+    }
+
+    // BC1 uses three colors plus transparent black when color0 <= color1, BC2/BC3 always four
+    void colorPalette(const u8* block, bool allowThreeColor, u8 palette[4][4])
+    {
+        u16 color0 = read16LE(block);
+        u16 color1 = read16LE(block + 2);
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+
+        for (u32 c = 0; c < 3; c++) {
+            if (color0 > color1 || !allowThreeColor) {
+                palette[2][c] = (u8)((2 * palette[0][c] + palette[1][c]) / 3);
+                palette[3][c] = (u8)((palette[0][c] + 2 * palette[1][c]) / 3);
+            }
+            else {
+                palette[2][c] = (u8)((palette[0][c] + palette[1][c]) / 2);
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = (color0 > color1 || !allowThreeColor) ? 255 : 0;
+    }
+
+    // Bounding box of the block inset by 1/16 of its extent (van Waveren, "Real-Time DXT Compression")
+    void encodeColorFast(const u8* pixels, u8* block)
+    {
+        u8 low[3] = { 255, 255, 255 };
+        u8 high[3] = { 0, 0, 0 };
+        for (u32 i = 0; i < 16; i++) {
+            for (u32 c = 0; c < 3; c++) {
+                low[c] = std::min(low[c], pixels[i * 4 + c]);
+                high[c] = std::max(high[c], pixels[i * 4 + c]);
+            }
+        }
+        for (u32 c = 0; c < 3; c++) {
+            u8 inset = (u8)((high[c] - low[c]) >> 4);
+            low[c] += inset;
+            high[c] -= inset;
+        }
+
+        u16 color0 = packRGB565(high);
+        u16 color1 = packRGB565(low);
+        if (color0 < color1) std::swap(color0, color1);
+        write16LE(block, color0);
+        write16LE(block + 2, color1);
+
+        u32 indices = 0;
+        if (color0 != color1) {
+            u8 palette[4][4];
+            colorPalette(block, false, palette);
+            for (u32 i = 0; i < 16; i++) {
+                const u8* pixel = pixels + i * 4;
+                u32 best = 0;
+                u32 bestError = ~0u;
+                for (u32 p = 0; p < 4; p++) {
+                    u32 error = square(pixel[0] - palette[p][0]) + square(pixel[1] - palette[p][1]) + square(pixel[2] - palette[p][2]);
+                    if (error < bestError) {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= best << (i * 2);
+            }
+        }
+        block[4] = (u8)indices;
+        block[5] = (u8)(indices >> 8);
+        block[6] = (u8)(indices >> 16);
+        block[7] = (u8)(indices >> 24);
+    }
+
+    void encodeColor(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        if (quality == BflimEncodeQuality::Fast) {
+            encodeColorFast(pixels, block);
+        }
+        else {
+            stb_compress_dxt_block(block, pixels, 0, stbMode(quality));
+        }
+    }
+
+    u64 colorError(const u8* pixels, const u8* block, bool allowThreeColor, bool withAlpha)
+    {
+        u8 palette[4][4];
+        colorPalette(block, allowThreeColor, palette);
+
+        u64 error = 0;
+        for (u32 i = 0; i < 16; i++) {
+            const u8* color = palette[(block[4 + i / 4] >> ((i % 4) * 2)) & 3];
+            const u8* pixel = pixels + i * 4;
+            error += square(pixel[0] - color[0]) + square(pixel[1] - color[1]) + square(pixel[2] - color[2]);
+            if (withAlpha) error += square(pixel[3] - color[3]);
+        }
+        return error;
+    }
+
+    // ---- Interpolated alpha blocks (BC3 alpha, BC4, both halves of BC5) ----
+
+    void alphaPalette(u8 alpha0, u8 alpha1, u8 palette[8])
+    {
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        if (alpha0 > alpha1) {
+            for (u32 i = 1; i < 7; i++) {
+                palette[i + 1] = (u8)(((7 - i) * alpha0 + i * alpha1 + 3) / 7);
+            }
+        }
+        else {
+            for (u32 i = 1; i < 5; i++) {
+                palette[i + 1] = (u8)(((5 - i) * alpha0 + i * alpha1 + 2) / 5);
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // Picks the nearest palette entry per value, returns the squared error
+    u32 alphaIndices(const u8* values, const u8 palette[8], u64& indices)
+    {
+        u32 total = 0;
+        indices = 0;
+        for (u32 i = 0; i < 16; i++) {
+            u32 best = 0;
+            u32 bestError = ~0u;
+            for (u32 p = 0; p < 8; p++) {
+                u32 error = square(values[i] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (u64)best << (i * 3);
+            total += bestError;
+        }
+        return total;
+    }
+
+    void writeAlphaBlock(u8* block, u8 alpha0, u8 alpha1, u64 indices)
+    {
+        block[0] = alpha0;
+        block[1] = alpha1;
+        for (u32 i = 0; i < 6; i++) {
+            block[2 + i] = (u8)(indices >> (i * 8));
+        }
+    }
+
+    void encodeAlpha(const u8* values, u8* block, BflimEncodeQuality quality)
+    {
+        u8 low = *std::min_element(values, values + 16);
+        u8 high = *std::max_element(values, values + 16);
+
+        if (low == high) {
+            writeAlphaBlock(block, high, low, 0);
+            return;
+        }
+
+        if (quality == BflimEncodeQuality::Fast) {
+            // Evenly spaced palette, so the index is a rounded division
+            u64 indices = 0;
+            u32 range = high - low;
+            for (u32 i = 0; i < 16; i++) {
+                u32 step = ((values[i] - low) * 14 + range) / (2 * range);
+                u32 code = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+                indices |= (u64)code << (i * 3);
+            }
+            writeAlphaBlock(block, high, low, indices);
+            return;
+        }
+
+        u8 palette[8];
+        u64 indices;
+        alphaPalette(high, low, palette);
+        u32 bestError = alphaIndices(values, palette, indices);
+        u8 best0 = high;
+        u8 best1 = low;
+        u64 bestIndices = indices;
+
+        if (quality == BflimEncodeQuality::High) {
+            // Pulling the endpoints inwards often fits the interior values better
+            const int window = 4;
+            for (int d0 = 0; d0 <= window && bestError; d0++) {
+                for (int d1 = 0; d1 <= window && bestError; d1++) {
+                    int alpha0 = high - d0;
+                    int alpha1 = low + d1;
+                    if (alpha0 <= alpha1 || (d0 == 0 && d1 == 0)) continue;
+
+                    alphaPalette((u8)alpha0, (u8)alpha1, palette);
+                    u32 error = alphaIndices(values, palette, indices);
+                    if (error < bestError) {
+                        bestError = error;
+                        best0 = (u8)alpha0;
+                        best1 = (u8)alpha1;
+                        bestIndices = indices;
+                    }
+                }
+            }
+
+            // Six value mode keeps exact 0 and 255, the endpoints only span the values in between
+            u8 innerLow = 255;
+            u8 innerHigh = 0;
+            for (u32 i = 0; i < 16; i++) {
+                if (values[i] != 0 && values[i] != 255) {
+                    innerLow = std::min(innerLow, values[i]);
+                    innerHigh = std::max(innerHigh, values[i]);
+                }
+            }
+            if (innerLow > innerHigh) {
+                innerLow = innerHigh = 0;
+            }
+
+            alphaPalette(innerLow, innerHigh, palette);
+            u32 error = alphaIndices(values, palette, indices);
+            if (error < bestError) {
+                bestError = error;
+                best0 = innerLow;
+                best1 = innerHigh;
+                bestIndices = indices;
+            }
+        }
+
+        writeAlphaBlock(block, best0, best1, bestIndices);
+    }
+
+    u64 alphaError(const u8* values, const u8* block)
+    {
+        u8 palette[8];
+        alphaPalette(block[0], block[1], palette);
+
+        u64 indices = 0;
+        for (u32 i = 0; i < 6; i++) {
+            indices |= (u64)block[2 + i] << (i * 8);
+        }
+
+        u64 error = 0;
+        for (u32 i = 0; i < 16; i++) {
+            error += square(values[i] - palette[(indices >> (i * 3)) & 7]);
+        }
+        return error;
+    }
+
+    inline void gatherChannel(const u8* pixels, u32 channel, u8* values)
+    {
+        for (u32 i = 0; i < 16; i++) {
+            values[i] = pixels[i * 4 + channel];
+        }
+    }
+
+    inline void gatherLuminance(const u8* pixels, u8* values)
+    {
+        for (u32 i = 0; i < 16; i++) {
+            values[i] = luminance(pixels + i * 4);
+        }
+    }
+
+    // ---- Per-format codecs ----
+
+    void encodeRGBA8(const u8* pixels, u8* element, BflimEncodeQuality)
+    {
+        std::memcpy(element, pixels, 4);
+    }
+
+    u64 errorRGBA8(const u8*, const u8*)
+    {
+        return 0;
+    }
+
+    void encodeBC1(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        encodeColor(pixels, block, quality);
+    }
+
+    u64 errorBC1(const u8* pixels, const u8* block)
+    {
+        return colorError(pixels, block, true, false);
+    }
+
+    void encodeBC2(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        // Explicit 4-bit alpha, first pixel in the low nibble
+        for (u32 i = 0; i < 8; i++) {
+            u32 low = (pixels[(i * 2) * 4 + 3] * 15 + 127) / 255;
+            u32 high = (pixels[(i * 2 + 1) * 4 + 3] * 15 + 127) / 255;
+            block[i] = (u8)(low | (high << 4));
+        }
+        encodeColor(pixels, block + 8, quality);
+    }
+
+    u64 errorBC2(const u8* pixels, const u8* block)
+    {
+        u64 error = colorError(pixels, block + 8, false, false);
+        for (u32 i = 0; i < 16; i++) {
+            u32 alpha = ((block[i / 2] >> ((i & 1) * 4)) & 0xF) * 17;
+            error += square(pixels[i * 4 + 3] - (int)alpha);
+        }
+        return error;
+    }
+
+    void encodeBC3(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        if (quality == BflimEncodeQuality::Normal) {
+            stb_compress_dxt_block(block, pixels, 1, STB_DXT_NORMAL);
+            return;
+        }
+
+        u8 alpha[16];
+        gatherChannel(pixels, 3, alpha);
+        encodeAlpha(alpha, block, quality);
+        encodeColor(pixels, block + 8, quality);
+    }
+
+    u64 errorBC3(const u8* pixels, const u8* block)
+    {
+        u8 alpha[16];
+        gatherChannel(pixels, 3, alpha);
+        return alphaError(alpha, block) + colorError(pixels, block + 8, false, false);
+    }
+
+    void encodeBC4L(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        u8 values[16];
+        gatherLuminance(pixels, values);
+        encodeAlpha(values, block, quality);
+    }
+
+    u64 errorBC4L(const u8* pixels, const u8* block)
+    {
+        u8 values[16];
+        gatherLuminance(pixels, values);
+        return alphaError(values, block);
+    }
+
+    void encodeBC4A(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        u8 values[16];
+        gatherChannel(pixels, 0, values);
+        encodeAlpha(values, block, quality);
+    }
+
+    u64 errorBC4A(const u8* pixels, const u8* block)
+    {
+        u8 values[16];
+        gatherChannel(pixels, 0, values);
+        return alphaError(values, block);
+    }
+
+    void encodeBC5(const u8* pixels, u8* block, BflimEncodeQuality quality)
+    {
+        u8 values[16];
+        gatherChannel(pixels, 0, values);
+        encodeAlpha(values, block, quality);
+        gatherChannel(pixels, 1, values);
+        encodeAlpha(values, block + 8, quality);
+    }
+
+    u64 errorBC5(const u8* pixels, const u8* block)
+    {
+        u8 values[16];
+        gatherChannel(pixels, 0, values);
+        u64 error = alphaError(values, block);
+        gatherChannel(pixels, 1, values);
+        return error + alphaError(values, block + 8);
+    }
+
+    using BflimEncoders::Codec;
+
+    // Indexed by format ID; sRGB variants store the same bits
+    constexpr Codec Codecs[] =
+    {
+        {},                                     // 0x00 L8
+        {},                                     // 0x01 A8
+        {},                                     // 0x02 LA4
+        {},                                     // 0x03 LA8
+        {},                                     // 0x04 HILO8
+        {},                                     // 0x05 RGB565
+        {},                                     // 0x06 RGBX8
+        {},                                     // 0x07 RGB5A1
+        {},                                     // 0x08 RGBA4
+        { encodeRGBA8, errorRGBA8, 4 },         // 0x09 RGBA8
+        {},                                     // 0x0A ETC1
+        {},                                     // 0x0B ETC1A4
+        { encodeBC1, errorBC1, 3 },             // 0x0C BC1
+        { encodeBC2, errorBC2, 4 },             // 0x0D BC2
+        { encodeBC3, errorBC3, 4 },             // 0x0E BC3
+        { encodeBC4L, errorBC4L, 1 },           // 0x0F BC4 L
+        { encodeBC4A, errorBC4A, 1 },           // 0x10 BC4 A
+        { encodeBC5, errorBC5, 2 },             // 0x11 BC5
+        {},                                     // 0x12 L4
+        {},                                     // 0x13 A4
+        { encodeRGBA8, errorRGBA8, 4 },         // 0x14 RGBA8 sRGB
+        { encodeBC1, errorBC1, 3 },             // 0x15 BC1 sRGB
+        { encodeBC2, errorBC2, 4 },             // 0x16 BC2 sRGB
+        { encodeBC3, errorBC3, 4 },             // 0x17 BC3 sRGB
+        {},                                     // 0x18 RGB10A2
+        {},                                     // 0x19 RGB565 indirect
+    };
+
+    static_assert(std::size(Codecs) == std::size(BflimConstants::SupportedFormats),
+                  "Codecs needs one entry per supported format");
+
+    constexpr Codec NoCodec = {};
+}
+
+const BflimEncoders::Codec& BflimEncoders::get(u8 formatId)
+{
+    if (formatId >= std::size(Codecs)) {
+        return NoCodec;
+    }
+
+    initStbDxt();
+    return Codecs[formatId];
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <types.h>
+
+enum class BflimEncodeQuality : u8
+{
+    Fast,       // bounding-box endpoints, no refinement
+    Normal,     // stb_dxt default
+    High        // stb_dxt high quality, endpoint search for alpha/BC4/BC5 blocks
+};
+
+struct BflimEncodeOptions
+{
+    BflimEncodeQuality quality = BflimEncodeQuality::Normal;
+    // Fill BflimEncodeMetrics after every encode (costs one block decode per element)
+    bool computeMetrics = false;
+};
+
+// Error of the last encode over the channels the format stores
+struct BflimEncodeMetrics
+{
+    bool valid = false;
+    double mse = 0.0;
+    // Infinite for a lossless result
+    double psnr = 0.0;
+};
+
+// Per-format element encoders, one table entry per BflimConstants::SupportedFormats ID.
+// An element is a 4x4 block for BCn formats (16 RGBA8 pixels, row major) or one pixel.
+// Single channel formats take luminance (BC4 L) or red (BC4 A, shown as grey like A8);
+// BC5 takes red and green.
+namespace BflimEncoders
+{
+    using Encoder = void (*)(const u8* pixels, u8* element, BflimEncodeQuality quality);
+    // Sum of squared differences over the stored channels of every pixel in the element
+    using ErrorFunction = u64 (*)(const u8* pixels, const u8* element);
+
+    struct Codec
+    {
+        Encoder encode = nullptr;
+        ErrorFunction error = nullptr;
+        // Channels error() sums over, per pixel
+        u8 channels = 0;
+    };
+
+    // encode is nullptr for formats that cannot be encoded
+    const Codec& get(u8 formatId);
+}
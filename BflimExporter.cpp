@@ -0,0 +1,286 @@
+#include <BflimExporter.h>
+#include <Bflim.h>
+#include <BflimFormats.h>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    // DDS_PIXELFORMAT flags
+    constexpr u32 DdpfAlphaPixels = 0x1;
+    constexpr u32 DdpfAlpha = 0x2;
+    constexpr u32 DdpfFourCC = 0x4;
+    constexpr u32 DdpfRGB = 0x40;
+    constexpr u32 DdpfLuminance = 0x20000;
+
+    constexpr u32 fourCC(const char (&code)[5])
+    {
+        return (u32)(u8)code[0] | ((u32)(u8)code[1] << 8) | ((u32)(u8)code[2] << 16) | ((u32)(u8)code[3] << 24);
+    }
+
+    struct ContainerFormat
+    {
+        // DDS: a DXGI format gets a DX10 header, otherwise the legacy pixel format is used
+        u32 dxgiFormat;
+        u32 ddsFourCC;
+        u32 ddsFlags;
+        u32 ddsBitCount;
+        u32 ddsMasks[4];
+        // KTX: glType and glFormat are 0 for compressed formats, glInternalFormat 0 = not supported
+        u32 glType;
+        u32 glTypeSize;
+        u32 glFormat;
+        u32 glInternalFormat;
+        u32 glBaseInternalFormat;
+    };
+
+    // GL enums
+    constexpr u32 GlUnsignedByte = 0x1401;
+    constexpr u32 GlUnsignedShort565Rev = 0x8364;
+    constexpr u32 GlUnsignedShort4444Rev = 0x8365;
+    constexpr u32 GlUnsignedShort1555Rev = 0x8366;
+    constexpr u32 GlUnsignedInt2101010Rev = 0x8368;
+    constexpr u32 GlRed = 0x1903;
+    constexpr u32 GlAlpha = 0x1906;
+    constexpr u32 GlRGB = 0x1907;
+    constexpr u32 GlRGBA = 0x1908;
+    constexpr u32 GlLuminance = 0x1909;
+    constexpr u32 GlLuminanceAlpha = 0x190A;
+    constexpr u32 GlRG = 0x8227;
+
+    // Indexed by format ID. GX2 packs components from the least significant bit up and
+    // stores words little endian, which is also what the DDS masks and the _REV GL types describe.
+    constexpr ContainerFormat ContainerFormats[] =
+    {
+        { 0,  0,              DdpfLuminance,                 8,  { 0xFF, 0, 0, 0 },                  GlUnsignedByte,          1, GlLuminance,      0x8040, GlLuminance },      // 0x00 L8
+        { 0,  0,              DdpfAlpha,                     8,  { 0, 0, 0, 0xFF },                  GlUnsignedByte,          1, GlAlpha,          0x803C, GlAlpha },          // 0x01 A8
+        { 0,  0,              DdpfLuminance | DdpfAlphaPixels, 8, { 0x0F, 0, 0, 0xF0 },              0,                       0, 0,                0,      0 },                // 0x02 LA4
+        { 0,  0,              DdpfLuminance | DdpfAlphaPixels, 16, { 0xFF, 0, 0, 0xFF00 },           GlUnsignedByte,          1, GlLuminanceAlpha, 0x8045, GlLuminanceAlpha }, // 0x03 LA8
+        { 49, 0,              0,                             0,  {},                                 GlUnsignedByte,          1, GlRG,             0x822B, GlRG },             // 0x04 HILO8
+        { 0,  0,              DdpfRGB,                       16, { 0x001F, 0x07E0, 0xF800, 0 },      GlUnsignedShort565Rev,   2, GlRGB,            0x8D62, GlRGB },            // 0x05 RGB565
+        { 0,  0,              DdpfRGB,                       32, { 0xFF, 0xFF00, 0xFF0000, 0 },      GlUnsignedByte,          1, GlRGBA,           0x8051, GlRGB },            // 0x06 RGBX8
+        { 0,  0,              DdpfRGB | DdpfAlphaPixels,     16, { 0x001F, 0x03E0, 0x7C00, 0x8000 }, GlUnsignedShort1555Rev,  2, GlRGBA,           0x8057, GlRGBA },           // 0x07 RGB5A1
+        { 0,  0,              DdpfRGB | DdpfAlphaPixels,     16, { 0x000F, 0x00F0, 0x0F00, 0xF000 }, GlUnsignedShort4444Rev,  2, GlRGBA,           0x8056, GlRGBA },           // 0x08 RGBA4
+        { 28, 0,              0,                             0,  {},                                 GlUnsignedByte,          1, GlRGBA,           0x8058, GlRGBA },           // 0x09 RGBA8
+        {},                                                                                                                                                                 // 0x0A ETC1 (3DS)
+        {},                                                                                                                                                                 // 0x0B ETC1A4 (3DS)
+        { 71, fourCC("DXT1"), DdpfFourCC,                    0,  {},                                 0,                       1, 0,                0x83F1, GlRGBA },           // 0x0C BC1
+        { 74, fourCC("DXT3"), DdpfFourCC,                    0,  {},                                 0,                       1, 0,                0x83F2, GlRGBA },           // 0x0D BC2
+        { 77, fourCC("DXT5"), DdpfFourCC,                    0,  {},                                 0,                       1, 0,                0x83F3, GlRGBA },           // 0x0E BC3
+        { 80, 0,              0,                             0,  {},                                 0,                       1, 0,                0x8DBB, GlRed },            // 0x0F BC4 L
+        { 80, 0,              0,                             0,  {},                                 0,                       1, 0,                0x8DBB, GlRed },            // 0x10 BC4 A, the channel lands in red
+        { 83, 0,              0,                             0,  {},                                 0,                       1, 0,                0x8DBD, GlRG },             // 0x11 BC5
+        {},                                                                                                                                                                 // 0x12 L4 (3DS)
+        {},                                                                                                                                                                 // 0x13 A4 (3DS)
+        { 29, 0,              0,                             0,  {},                                 GlUnsignedByte,          1, GlRGBA,           0x8C43, GlRGBA },           // 0x14 RGBA8 sRGB
+        { 72, 0,              0,                             0,  {},                                 0,                       1, 0,                0x8C4D, GlRGBA },           // 0x15 BC1 sRGB
+        { 75, 0,              0,                             0,  {},                                 0,                       1, 0,                0x8C4E, GlRGBA },           // 0x16 BC2 sRGB
+        { 78, 0,              0,                             0,  {},                                 0,                       1, 0,                0x8C4F, GlRGBA },           // 0x17 BC3 sRGB
+        { 24, 0,              0,                             0,  {},                                 GlUnsignedInt2101010Rev, 4, GlRGBA,           0x8059, GlRGBA },           // 0x18 RGB10A2
+        { 0,  0,              DdpfRGB,                       16, { 0x001F, 0x07E0, 0xF800, 0 },      GlUnsignedShort565Rev,   2, GlRGB,            0x8D62, GlRGB },            // 0x19 RGB565 indirect
+    };
+
+    static_assert(std::size(ContainerFormats) == std::size(BflimConstants::SupportedFormats),
+                  "ContainerFormats must have one entry per SupportedFormats ID");
+
+    constexpr size_t DdsHeaderSize = 4 + 124;
+    constexpr size_t Dx10HeaderSize = 20;
+    constexpr size_t KtxHeaderSize = 64 + 4;   // plus the imageSize of the only mip level
+
+    const ContainerFormat* findContainerFormat(u8 formatId)
+    {
+        const Format* format = BflimConstants::findFormat(formatId);
+        if (!format || format->mGX2Format == GX2_SURFACE_FORMAT_INVALID) return nullptr;
+        return &ContainerFormats[formatId];
+    }
+
+    bool usesDx10Header(const ContainerFormat& format)
+    {
+        return format.dxgiFormat != 0 && format.ddsFlags == 0;
+    }
+
+    size_t getElementBytes(const Format& format)
+    {
+        return format.mBlockDim == 4 ? format.mBPP * 2 : format.mBPP / 8;
+    }
+
+    size_t getRowBytes(const Format& format, u16 width)
+    {
+        return (width + format.mBlockDim - 1) / format.mBlockDim * getElementBytes(format);
+    }
+
+    size_t getRowCount(const Format& format, u16 height)
+    {
+        return (height + format.mBlockDim - 1) / format.mBlockDim;
+    }
+
+    // KTX rows are 4-byte aligned (GL_UNPACK_ALIGNMENT), BCn rows always are
+    size_t getKtxRowBytes(const Format& format, u16 width)
+    {
+        return (getRowBytes(format, width) + 3) & ~(size_t)3;
+    }
+
+    void writeLE32(u8*& data, u32 value)
+    {
+        for (u32 i = 0; i < 4; i++) {
+            *data++ = (u8)(value >> (i * 8));
+        }
+    }
+
+    void writeDDS(const Format& format, const ContainerFormat& container, u16 width, u16 height,
+                  const u8* elements, u8* output)
+    {
+        const size_t rowBytes = getRowBytes(format, width);
+        const size_t imageSize = rowBytes * getRowCount(format, height);
+        const bool compressed = format.mBlockDim == 4;
+
+        u8* p = output;
+        std::memcpy(p, "DDS ", 4);
+        p += 4;
+
+        // DDS_HEADER
+        writeLE32(p, 124);
+        // CAPS | HEIGHT | WIDTH | PIXELFORMAT, plus LINEARSIZE or PITCH
+        writeLE32(p, 0x1007 | (compressed ? 0x80000 : 0x8));
+        writeLE32(p, height);
+        writeLE32(p, width);
+        writeLE32(p, (u32)(compressed ? imageSize : rowBytes));
+        writeLE32(p, 0);    // depth
+        writeLE32(p, 1);    // mip levels
+        for (u32 i = 0; i < 11; i++) writeLE32(p, 0);
+
+        // DDS_PIXELFORMAT
+        const bool dx10 = usesDx10Header(container);
+        writeLE32(p, 32);
+        writeLE32(p, dx10 ? DdpfFourCC : container.ddsFlags);
+        writeLE32(p, dx10 ? fourCC("DX10") : container.ddsFourCC);
+        writeLE32(p, container.ddsBitCount);
+        for (u32 mask : container.ddsMasks) writeLE32(p, mask);
+
+        writeLE32(p, 0x1000);   // DDSCAPS_TEXTURE
+        for (u32 i = 0; i < 4; i++) writeLE32(p, 0);
+
+        if (dx10) {
+            writeLE32(p, container.dxgiFormat);
+            writeLE32(p, 3);    // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+            writeLE32(p, 0);
+            writeLE32(p, 1);    // array size
+            writeLE32(p, 0);
+        }
+
+        std::memcpy(p, elements, imageSize);
+    }
+
+    void writeKTX(const Format& format, const ContainerFormat& container, u16 width, u16 height,
+                  const u8* elements, u8* output)
+    {
+        static const u8 Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        const size_t rowBytes = getRowBytes(format, width);
+        const size_t ktxRowBytes = getKtxRowBytes(format, width);
+        const size_t rows = getRowCount(format, height);
+
+        u8* p = output;
+        std::memcpy(p, Identifier, sizeof(Identifier));
+        p += sizeof(Identifier);
+
+        writeLE32(p, 0x04030201);   // endianness
+        writeLE32(p, container.glType);
+        writeLE32(p, container.glTypeSize);
+        writeLE32(p, container.glFormat);
+        writeLE32(p, container.glInternalFormat);
+        writeLE32(p, container.glBaseInternalFormat);
+        writeLE32(p, width);
+        writeLE32(p, height);
+        writeLE32(p, 0);    // depth
+        writeLE32(p, 0);    // array elements
+        writeLE32(p, 1);    // faces
+        writeLE32(p, 1);    // mip levels
+        writeLE32(p, 0);    // key/value data
+        writeLE32(p, (u32)(ktxRowBytes * rows));
+
+        if (ktxRowBytes == rowBytes) {
+            std::memcpy(p, elements, rowBytes * rows);
+            return;
+        }
+
+        for (size_t row = 0; row < rows; row++) {
+            std::memcpy(p, elements + row * rowBytes, rowBytes);
+            std::memset(p + rowBytes, 0, ktxRowBytes - rowBytes);
+            p += ktxRowBytes;
+        }
+    }
+}
+
+bool BflimExporter::isSupported(u8 formatId, BflimContainer container)
+{
+    const ContainerFormat* format = findContainerFormat(formatId);
+    if (!format) return false;
+
+    if (container == BflimContainer::KTX) return format->glInternalFormat != 0;
+    return format->dxgiFormat != 0 || format->ddsFlags != 0;
+}
+
+size_t BflimExporter::getFileSize(BflimContainer container, u16 width, u16 height, u8 formatId)
+{
+    if (!isSupported(formatId, container) || width == 0 || height == 0) return 0;
+
+    const Format& format = BflimConstants::SupportedFormats[formatId];
+    if (container == BflimContainer::KTX) {
+        return KtxHeaderSize + getKtxRowBytes(format, width) * getRowCount(format, height);
+    }
+
+    const size_t header = DdsHeaderSize + (usesDx10Header(ContainerFormats[formatId]) ? Dx10HeaderSize : 0);
+    return header + getRowBytes(format, width) * getRowCount(format, height);
+}
+
+bool BflimExporter::write(BflimContainer container, u16 width, u16 height, u8 formatId, const u8* elements,
+                          size_t elementsSize, u8* output, size_t outputSize, std::string& error)
+{
+    const size_t fileSize = getFileSize(container, width, height, formatId);
+    if (fileSize == 0) {
+        const Format* format = BflimConstants::findFormat(formatId);
+        error = std::string("Format ") + (format ? format->mName : std::to_string(formatId).c_str()) +
+                " cannot be exported to " + (container == BflimContainer::KTX ? "KTX" : "DDS") + "!";
+        return false;
+    }
+
+    if (outputSize < fileSize) {
+        error = "Output buffer smaller than the file (" + std::to_string(fileSize) + " bytes)!";
+        return false;
+    }
+
+    const Format& format = BflimConstants::SupportedFormats[formatId];
+    if (elements == nullptr || elementsSize < getRowBytes(format, width) * getRowCount(format, height)) {
+        error = "Element data smaller than the image!";
+        return false;
+    }
+
+    if (container == BflimContainer::KTX) {
+        writeKTX(format, ContainerFormats[formatId], width, height, elements, output);
+    }
+    else {
+        writeDDS(format, ContainerFormats[formatId], width, height, elements, output);
+    }
+    return true;
+}
+
+std::vector<u8> BflimExporter::exportTexture(const Bflim& bflim, const u8* data, size_t size, BflimContainer container,
+                                             std::string& error)
+{
+    const u8 formatId = bflim.getImageFormat().mId;
+    std::vector<u8> output(getFileSize(container, bflim.getImageWidth(), bflim.getImageHeight(), formatId));
+
+    std::vector<u8> elements;
+    if (!bflim.deswizzleElements(data, size, elements, error) ||
+        !write(container, bflim.getImageWidth(), bflim.getImageHeight(), formatId, elements.data(), elements.size(),
+               output.data(), output.size(), error)) {
+        return std::vector<u8>();
+    }
+    return output;
+}
+
+const char* BflimExporter::getExtension(BflimContainer container)
+{
+    return container == BflimContainer::KTX ? ".ktx" : ".dds";
+}
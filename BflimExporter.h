@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <types.h>
+
+class Bflim;
+
+enum class BflimContainer : u8
+{
+    DDS,    // DX10 header for formats with an exact DXGI format, FourCC/bit masks otherwise
+    KTX     // KTX 1.1, one mip level
+};
+
+// Wraps deswizzled Wii U texture data (texels or BCn blocks exactly as stored) in a
+// DDS or KTX container, so GPU uploads skip the BCn decode and re-encode.
+class BflimExporter
+{
+public:
+    // false if the container has no format with the same bit layout (3DS-only formats, LA4 in KTX)
+    static bool isSupported(u8 formatId, BflimContainer container);
+    // Header plus image data, 0 if not supported
+    static size_t getFileSize(BflimContainer container, u16 width, u16 height, u8 formatId);
+
+    // elements are packed row-major elements as returned by Bflim::deswizzleElements
+    static bool write(BflimContainer container, u16 width, u16 height, u8 formatId, const u8* elements,
+                      size_t elementsSize, u8* output, size_t outputSize, std::string& error);
+
+    // Deswizzles the payload of a parsed texture and wraps it, empty on error
+    static std::vector<u8> exportTexture(const Bflim& bflim, const u8* data, size_t size, BflimContainer container,
+                                         std::string& error);
+
+    // File extension including the dot
+    static const char* getExtension(BflimContainer container);
+};
@@ -1,47 +1,67 @@
 #pragma once
-#include <vector>
-#include <string>
-#include <types.h> 
+#include <iterator>
+#include <types.h>
 #include <ninTexUtils/gx2/gx2Enum.h>
 
-struct Format 
+struct Format
 {
-    u8 mId;
-    std::string mName;
-    std::string mType;
-    u8 mBPP;
-    std::string mSuffix;
+    u8 mId = 0;
+    const char* mName = "";
+    const char* mType = "";
+    u8 mBPP = 0;
+    const char* mSuffix = "";
+    // Surface format for the GX2 tiling math, INVALID for formats only the 3DS stores
+    GX2SurfaceFormat mGX2Format = GX2_SURFACE_FORMAT_INVALID;
+    // 4 for block compressed formats (4x4 pixels per element), 1 otherwise
+    u8 mBlockDim = 1;
 };
 
-namespace BflimConstants 
+namespace BflimConstants
 {
-    inline const std::vector<Format> SupportedFormats = 
+    // Indexed by format ID
+    inline constexpr Format SupportedFormats[] =
     {
-    { 0x00,  "L8_UNORM",              "Luminance",              8,    "^c"      },
-    { 0x01,  "A8_UNORM",              "Alpha",                  8,    "^d"      },
-    { 0x02,  "LA4_UNORM",             "Luminance Alpha",        8,    "^e"      },
-    { 0x03,  "LA8_UNORM",             "Luminance Alpha",        16,   "^f"      },
-    { 0x04,  "HILO8",                 "High-Low",               16,   "^g"      },
-    { 0x05,  "RGB565_UNORM",          "Color",                  16,   "^h"      },
-    { 0x06,  "RGBX8_UNORM",           "Color",                  32,   "^i"      },
-    { 0x07,  "RGB5A1_UNORM",          "Color Alpha",            16,   "^j"      },
-    { 0x08,  "RGBA4_UNORM",           "Color Alpha",            16,   "^k"      },
-    { 0x09,  "RGBA8_UNORM",           "Color Alpha",            32,   "^l"      },
-   { 0x0A,  "ETC1_UNORM",            "ETC1",                   4,    "^m"      },
-   { 0x0B,  "ETC1A4_UNORM",          "ETC1 Alpha 4",           8,    "^n"      },
-   { 0x0C,  "BC1_UNORM",             "BC1 (DXT1)",             4,    "^o"      },
-   { 0x0D,  "BC2_UNORM",             "BC2 (DXT3)",             8,    "^p"      },
-   { 0x0E,  "BC3_UNORM",             "BC3 (DXT5)",             8,    "^q"      },
-   { 0x0F,  "BC4L_UNORM",            "BC4 (Luminance)",        4,    "^r"      },
-   { 0x10,  "BC4A_UNORM",            "BC4 (Alpha)",            4,    "^s"      },
-   { 0x11,  "BC5_UNORM",             "BC5 (RG)",               8,    "^t"      },
-   { 0x12,  "L4_UNORM",              "Luminance",              4,    "^u"      },
-   { 0x13,  "A4_UNORM",              "Alpha",                  4,    "^v"      },
-   { 0x14,  "RGBA8_SRGB",            "Color Alpha (sRGB)",     32,   "^w"      },
-   { 0x15,  "BC1_SRGB",              "BC1 (sRGB)",             4,    "^x"      },
-   { 0x16,  "BC2_SRGB",              "BC2 (sRGB)",             8,    "^y"      },
-   { 0x17,  "BC3_SRGB",              "BC3 (sRGB)",             8,    "^z"      },
-   { 0x18,  "RGB10A2_UNORM",         "Color Alpha (10-bit)",   32,   "unk"     },
-   { 0x19,  "RGB565_INDIRECT_UNORM", "Color (Indirect)",       16,   "unk"     }
+    { 0x00,  "L8_UNORM",              "Luminance",              8,    "^c",  GX2_SURFACE_FORMAT_UNORM_R8,      1 },
+    { 0x01,  "A8_UNORM",              "Alpha",                  8,    "^d",  GX2_SURFACE_FORMAT_UNORM_R8,      1 },
+    { 0x02,  "LA4_UNORM",             "Luminance Alpha",        8,    "^e",  GX2_SURFACE_FORMAT_UNORM_RG4,     1 },
+    { 0x03,  "LA8_UNORM",             "Luminance Alpha",        16,   "^f",  GX2_SURFACE_FORMAT_UNORM_RG8,     1 },
+    { 0x04,  "HILO8",                 "High-Low",               16,   "^g",  GX2_SURFACE_FORMAT_UNORM_RG8,     1 },
+    { 0x05,  "RGB565_UNORM",          "Color",                  16,   "^h",  GX2_SURFACE_FORMAT_UNORM_RGB565,  1 },
+    { 0x06,  "RGBX8_UNORM",           "Color",                  32,   "^i",  GX2_SURFACE_FORMAT_UNORM_RGBA8,   1 },
+    { 0x07,  "RGB5A1_UNORM",          "Color Alpha",            16,   "^j",  GX2_SURFACE_FORMAT_UNORM_RGB5A1,  1 },
+    { 0x08,  "RGBA4_UNORM",           "Color Alpha",            16,   "^k",  GX2_SURFACE_FORMAT_UNORM_RGBA4,   1 },
+    { 0x09,  "RGBA8_UNORM",           "Color Alpha",            32,   "^l",  GX2_SURFACE_FORMAT_UNORM_RGBA8,   1 },
+   { 0x0A,  "ETC1_UNORM",            "ETC1",                   4,    "^m",  GX2_SURFACE_FORMAT_INVALID,      4 },
+   { 0x0B,  "ETC1A4_UNORM",          "ETC1 Alpha 4",           8,    "^n",  GX2_SURFACE_FORMAT_INVALID,      4 },
+   { 0x0C,  "BC1_UNORM",             "BC1 (DXT1)",             4,    "^o",  GX2_SURFACE_FORMAT_UNORM_BC1,     4 },
+   { 0x0D,  "BC2_UNORM",             "BC2 (DXT3)",             8,    "^p",  GX2_SURFACE_FORMAT_UNORM_BC2,     4 },
+   { 0x0E,  "BC3_UNORM",             "BC3 (DXT5)",             8,    "^q",  GX2_SURFACE_FORMAT_UNORM_BC3,     4 },
+   { 0x0F,  "BC4L_UNORM",            "BC4 (Luminance)",        4,    "^r",  GX2_SURFACE_FORMAT_UNORM_BC4,     4 },
+   { 0x10,  "BC4A_UNORM",            "BC4 (Alpha)",            4,    "^s",  GX2_SURFACE_FORMAT_UNORM_BC4,     4 },
+   { 0x11,  "BC5_UNORM",             "BC5 (RG)",               8,    "^t",  GX2_SURFACE_FORMAT_UNORM_BC5,     4 },
+   { 0x12,  "L4_UNORM",              "Luminance",              4,    "^u",  GX2_SURFACE_FORMAT_INVALID,      1 },
+   { 0x13,  "A4_UNORM",              "Alpha",                  4,    "^v",  GX2_SURFACE_FORMAT_INVALID,      1 },
+   { 0x14,  "RGBA8_SRGB",            "Color Alpha (sRGB)",     32,   "^w",  GX2_SURFACE_FORMAT_SRGB_RGBA8,    1 },
+   { 0x15,  "BC1_SRGB",              "BC1 (sRGB)",             4,    "^x",  GX2_SURFACE_FORMAT_SRGB_BC1,      4 },
+   { 0x16,  "BC2_SRGB",              "BC2 (sRGB)",             8,    "^y",  GX2_SURFACE_FORMAT_SRGB_BC2,      4 },
+   { 0x17,  "BC3_SRGB",              "BC3 (sRGB)",             8,    "^z",  GX2_SURFACE_FORMAT_SRGB_BC3,      4 },
+   { 0x18,  "RGB10A2_UNORM",         "Color Alpha (10-bit)",   32,   "unk", GX2_SURFACE_FORMAT_UNORM_RGB10A2, 1 },
+   { 0x19,  "RGB565_INDIRECT_UNORM", "Color (Indirect)",       16,   "unk", GX2_SURFACE_FORMAT_UNORM_RGB565,  1 }
     };
+
+    constexpr bool formatIdsMatchIndices()
+    {
+        for (size_t i = 0; i < std::size(SupportedFormats); i++) {
+            if (SupportedFormats[i].mId != i) return false;
+        }
+        return true;
+    }
+
+    static_assert(formatIdsMatchIndices(), "SupportedFormats must be indexed by format ID");
+
+    // nullptr if the ID is not a known format
+    constexpr const Format* findFormat(u8 id)
+    {
+        return id < std::size(SupportedFormats) ? &SupportedFormats[id] : nullptr;
+    }
 }
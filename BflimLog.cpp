@@ -0,0 +1,67 @@
+#include <BflimLog.h>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+std::atomic<u8> BflimLog::Detail::gThreshold((u8)BflimLog::Level::Warning + 1);
+
+namespace
+{
+    std::mutex& sinkMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Swapped as a whole so write() can call it without holding the lock
+    std::shared_ptr<const BflimLog::Sink>& currentSink()
+    {
+        static std::shared_ptr<const BflimLog::Sink> sink =
+            std::make_shared<const BflimLog::Sink>(BflimLog::stderrSink());
+        return sink;
+    }
+}
+
+void BflimLog::setSink(Sink sink, Level maxLevel)
+{
+    std::lock_guard<std::mutex> lock(sinkMutex());
+    if (sink) {
+        currentSink() = std::make_shared<const Sink>(std::move(sink));
+        Detail::gThreshold.store((u8)maxLevel + 1, std::memory_order_relaxed);
+    }
+    else {
+        Detail::gThreshold.store(0, std::memory_order_relaxed);
+        currentSink().reset();
+    }
+}
+
+BflimLog::Sink BflimLog::stderrSink()
+{
+    return [](Level level, const std::string& message) {
+        std::fprintf(stderr, "[Bflim %s] %s\n", getLevelName(level), message.c_str());
+    };
+}
+
+const char* BflimLog::getLevelName(Level level)
+{
+    switch (level) {
+        case Level::Error: return "error";
+        case Level::Warning: return "warning";
+        case Level::Info: return "info";
+        case Level::Debug: return "debug";
+    }
+    return "unknown";
+}
+
+void BflimLog::write(Level level, const std::string& message)
+{
+    std::shared_ptr<const Sink> sink;
+    {
+        std::lock_guard<std::mutex> lock(sinkMutex());
+        sink = currentSink();
+    }
+
+    if (sink && isEnabled(level)) {
+        (*sink)(level, message);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <types.h>
+
+// Where the library's diagnostics go. The default sink writes errors and warnings
+// to stderr; setSink(nullptr) turns logging off, after which BFLIM_LOG costs one
+// atomic load and never formats its message.
+namespace BflimLog
+{
+    enum class Level : u8
+    {
+        Error,
+        Warning,
+        Info,
+        Debug
+    };
+
+    using Sink = std::function<void(Level level, const std::string& message)>;
+
+    // Messages above maxLevel are dropped before they are formatted
+    void setSink(Sink sink, Level maxLevel = Level::Warning);
+    Sink stderrSink();
+    const char* getLevelName(Level level);
+
+    void write(Level level, const std::string& message);
+
+    namespace Detail
+    {
+        // Highest enabled level + 1, 0 when there is no sink
+        extern std::atomic<u8> gThreshold;
+    }
+
+    inline bool isEnabled(Level level)
+    {
+        return (u8)level < Detail::gThreshold.load(std::memory_order_relaxed);
+    }
+}
+
+#define BFLIM_LOG(level, expression)                                   \
+    do {                                                               \
+        if (BflimLog::isEnabled(level)) {                              \
+            std::ostringstream bflimLogStream;                         \
+            bflimLogStream << expression;                              \
+            BflimLog::write(level, bflimLogStream.str());              \
+        }                                                              \
+    } while (0)
@@ -0,0 +1,184 @@
+#include <BflimProfiler.h>
+#include <BflimLog.h>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> BflimProfiler::Detail::gEnabled(false);
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct StageCounters
+    {
+        std::atomic<u64> calls{0};
+        std::atomic<u64> nanoseconds{0};
+        std::atomic<u64> bytes{0};
+        std::atomic<u64> allocations{0};
+        std::atomic<u64> allocatedBytes{0};
+    };
+
+    struct TraceEvent
+    {
+        BflimProfiler::Stage stage;
+        u32 thread;
+        u64 start;      // ns since startTrace()
+        u64 duration;   // ns, including nested scopes
+        u64 bytes;
+        u64 allocations;
+    };
+
+    StageCounters gCounters[(size_t)BflimProfiler::Stage::Count];
+
+    std::atomic<bool> gTracing(false);
+    std::mutex gTraceMutex;
+    std::vector<TraceEvent> gTraceEvents;
+    Clock::time_point gTraceStart;
+
+    thread_local BflimProfiler::Scope* tCurrentScope = nullptr;
+
+    u32 threadIndex()
+    {
+        static std::atomic<u32> nextIndex(1);
+        thread_local u32 index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    u64 toNanoseconds(Clock::duration duration)
+    {
+        return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+}
+
+void BflimProfiler::setEnabled(bool enabled)
+{
+    Detail::gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+BflimProfiler::Stats BflimProfiler::getStats()
+{
+    Stats stats;
+    for (size_t i = 0; i < (size_t)Stage::Count; i++) {
+        stats.stages[i].calls = gCounters[i].calls.load(std::memory_order_relaxed);
+        stats.stages[i].nanoseconds = gCounters[i].nanoseconds.load(std::memory_order_relaxed);
+        stats.stages[i].bytes = gCounters[i].bytes.load(std::memory_order_relaxed);
+        stats.stages[i].allocations = gCounters[i].allocations.load(std::memory_order_relaxed);
+        stats.stages[i].allocatedBytes = gCounters[i].allocatedBytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void BflimProfiler::reset()
+{
+    for (StageCounters& counters : gCounters) {
+        counters.calls = 0;
+        counters.nanoseconds = 0;
+        counters.bytes = 0;
+        counters.allocations = 0;
+        counters.allocatedBytes = 0;
+    }
+}
+
+const char* BflimProfiler::getStageName(Stage stage)
+{
+    switch (stage) {
+        case Stage::Parse: return "parse";
+        case Stage::Deswizzle: return "deswizzle";
+        case Stage::Decode: return "decode";
+        case Stage::Encode: return "encode";
+        case Stage::Swizzle: return "swizzle";
+        case Stage::RawDataUpdate: return "rawDataUpdate";
+        case Stage::Count: break;
+    }
+    return "unknown";
+}
+
+void BflimProfiler::startTrace()
+{
+    {
+        std::lock_guard<std::mutex> lock(gTraceMutex);
+        gTraceEvents.clear();
+        gTraceStart = Clock::now();
+    }
+    gTracing.store(true, std::memory_order_relaxed);
+    setEnabled(true);
+}
+
+void BflimProfiler::stopTrace()
+{
+    gTracing.store(false, std::memory_order_relaxed);
+}
+
+std::string BflimProfiler::getTraceJson()
+{
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+
+    std::string json = "{\"traceEvents\":[";
+    char buffer[256];
+    for (size_t i = 0; i < gTraceEvents.size(); i++) {
+        const TraceEvent& event = gTraceEvents[i];
+        std::snprintf(buffer, sizeof(buffer),
+                      "%s\n{\"name\":\"%s\",\"cat\":\"bflim\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+                      "\"args\":{\"bytes\":%llu,\"allocations\":%llu}}",
+                      i ? "," : "", getStageName(event.stage), event.start / 1000.0, event.duration / 1000.0,
+                      event.thread, (unsigned long long)event.bytes, (unsigned long long)event.allocations);
+        json += buffer;
+    }
+    json += "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return json;
+}
+
+bool BflimProfiler::writeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        BFLIM_LOG(BflimLog::Level::Error, "Cannot write trace file " << path);
+        return false;
+    }
+
+    file << getTraceJson();
+    return (bool)file;
+}
+
+void BflimProfiler::countAllocation(size_t bytes)
+{
+    if (Scope* scope = tCurrentScope) {
+        scope->mAllocations++;
+        scope->mAllocatedBytes += bytes;
+    }
+}
+
+void BflimProfiler::Scope::begin(Stage stage, u64 bytes)
+{
+    if (tCurrentScope && tCurrentScope->mStage == stage) return;
+
+    mActive = true;
+    mStage = stage;
+    mBytes = bytes;
+    mParent = tCurrentScope;
+    tCurrentScope = this;
+    mStart = Clock::now();
+}
+
+void BflimProfiler::Scope::end()
+{
+    Clock::time_point now = Clock::now();
+    u64 duration = toNanoseconds(now - mStart);
+    tCurrentScope = mParent;
+    if (mParent) mParent->mChildNanoseconds += duration;
+
+    StageCounters& counters = gCounters[(size_t)mStage];
+    counters.calls.fetch_add(1, std::memory_order_relaxed);
+    counters.nanoseconds.fetch_add(duration > mChildNanoseconds ? duration - mChildNanoseconds : 0, std::memory_order_relaxed);
+    counters.bytes.fetch_add(mBytes, std::memory_order_relaxed);
+    counters.allocations.fetch_add(mAllocations, std::memory_order_relaxed);
+    counters.allocatedBytes.fetch_add(mAllocatedBytes, std::memory_order_relaxed);
+
+    if (gTracing.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(gTraceMutex);
+        u64 start = mStart > gTraceStart ? toNanoseconds(mStart - gTraceStart) : 0;
+        gTraceEvents.push_back(TraceEvent{mStage, threadIndex(), start, duration, mBytes, mAllocations});
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <types.h>
+
+// Process-wide counters for the decode/encode pipeline and an optional Chrome trace
+// (chrome://tracing, Perfetto). Disabled by default; a disabled Scope is one atomic load.
+// Times are exclusive: a Swizzle scope inside an Encode scope is not counted as Encode.
+namespace BflimProfiler
+{
+    enum class Stage : u8
+    {
+        Parse,
+        Deswizzle,
+        Decode,
+        Encode,
+        Swizzle,
+        RawDataUpdate,
+        Count
+    };
+
+    struct StageStats
+    {
+        u64 calls = 0;
+        u64 nanoseconds = 0;
+        u64 bytes = 0;
+        u64 allocations = 0;
+        u64 allocatedBytes = 0;
+    };
+
+    struct Stats
+    {
+        StageStats stages[(size_t)Stage::Count];
+
+        const StageStats& operator[](Stage stage) const
+        {
+            return stages[(size_t)stage];
+        }
+    };
+
+    void setEnabled(bool enabled);
+    Stats getStats();
+    void reset();
+    const char* getStageName(Stage stage);
+
+    // Records one event per scope until stopTrace(); enables the counters as well
+    void startTrace();
+    void stopTrace();
+    // {"traceEvents": [...]} with complete ("X") events in microseconds
+    std::string getTraceJson();
+    bool writeTrace(const std::string& path);
+
+    // Attributes an allocation to the innermost scope on this thread
+    void countAllocation(size_t bytes);
+
+    namespace Detail
+    {
+        extern std::atomic<bool> gEnabled;
+    }
+
+    inline bool isEnabled()
+    {
+        return Detail::gEnabled.load(std::memory_order_relaxed);
+    }
+
+    // Times the enclosing block as one call of a stage. A scope nested in a scope of
+    // the same stage is ignored, so helpers can be instrumented without double counting.
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage, u64 bytes = 0)
+        {
+            if (isEnabled()) begin(stage, bytes);
+        }
+
+        ~Scope()
+        {
+            if (mActive) end();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void addBytes(u64 bytes)
+        {
+            mBytes += bytes;
+        }
+
+    private:
+        friend void countAllocation(size_t bytes);
+
+        void begin(Stage stage, u64 bytes);
+        void end();
+
+        bool mActive = false;
+        Stage mStage = Stage::Count;
+        u64 mBytes = 0;
+        u64 mAllocations = 0;
+        u64 mAllocatedBytes = 0;
+        u64 mChildNanoseconds = 0;
+        Scope* mParent = nullptr;
+        std::chrono::steady_clock::time_point mStart;
+    };
+}
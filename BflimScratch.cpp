@@ -0,0 +1,55 @@
+#include <BflimScratch.h>
+#include <BflimProfiler.h>
+#include <algorithm>
+
+BflimScratch::BflimScratch(size_t reserveBytes)
+{
+    if (reserveBytes) addBlock(reserveBytes);
+}
+
+u8* BflimScratch::allocate(size_t size)
+{
+    size = (std::max<size_t>(size, 1) + Alignment - 1) & ~(Alignment - 1);
+
+    if (mBlocks.empty() || mBlocks.back().size - mOffset < size) {
+        // Grow geometrically so a burst of requests needs few blocks
+        addBlock(std::max({size, mCapacity, MinBlockSize}));
+    }
+
+    u8* pointer = mBlocks.back().data.get() + mOffset;
+    mOffset += size;
+    mUsed += size;
+    mPeak = std::max(mPeak, mUsed);
+    return pointer;
+}
+
+void BflimScratch::reset()
+{
+    if (mBlocks.size() > 1) {
+        // Replace the chain by one block that fits everything used so far
+        size_t capacity = mCapacity;
+        mBlocks.clear();
+        mCapacity = 0;
+        addBlock(capacity);
+    }
+
+    mOffset = 0;
+    mUsed = 0;
+}
+
+void BflimScratch::release()
+{
+    mBlocks.clear();
+    mOffset = 0;
+    mUsed = 0;
+    mCapacity = 0;
+}
+
+void BflimScratch::addBlock(size_t size)
+{
+    // new[] aligns to at least 16 bytes, offsets keep that alignment
+    mBlocks.push_back(Block{std::unique_ptr<u8[]>(new u8[size]), size});
+    BflimProfiler::countAllocation(size);
+    mOffset = 0;
+    mCapacity += size;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <types.h>
+
+// Bump allocator for the temporary buffers of Bflim::decodeInto/encodeInto.
+// Memory is kept between calls and merged into one block on reset(), so once it
+// has seen the largest texture a long-running converter stops allocating.
+// Not thread-safe, use one per thread.
+class BflimScratch
+{
+public:
+    BflimScratch() = default;
+    explicit BflimScratch(size_t reserveBytes);
+
+    BflimScratch(const BflimScratch&) = delete;
+    BflimScratch& operator=(const BflimScratch&) = delete;
+
+    // size bytes, 16-byte aligned, valid until the next reset()
+    u8* allocate(size_t size);
+    // Makes all memory available again without freeing it
+    void reset();
+    // Frees everything
+    void release();
+
+    size_t getCapacity() const
+    {
+        return mCapacity;
+    }
+
+    // Largest amount used between two resets
+    size_t getPeakUsage() const
+    {
+        return mPeak;
+    }
+
+private:
+    static constexpr size_t Alignment = 16;
+    static constexpr size_t MinBlockSize = 64 * 1024;
+
+    struct Block
+    {
+        std::unique_ptr<u8[]> data;
+        size_t size;
+    };
+
+    void addBlock(size_t size);
+
+    std::vector<Block> mBlocks;
+    size_t mOffset = 0;   // into the last block
+    size_t mUsed = 0;
+    size_t mPeak = 0;
+    size_t mCapacity = 0;
+};
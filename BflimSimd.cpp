@@ -0,0 +1,357 @@
+#include <BflimSimd.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BFLIM_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BFLIM_TARGET(x)
+#else
+#define BFLIM_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace
+{
+    void expandL8Scalar(const u8* src, u8* dst, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) {
+            u8 l = src[i];
+            dst[i * 4 + 0] = l;
+            dst[i * 4 + 1] = l;
+            dst[i * 4 + 2] = l;
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    void expandLA8Scalar(const u8* src, u8* dst, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) {
+            u8 l = src[i * 2 + 0];
+            u8 a = src[i * 2 + 1];
+            dst[i * 4 + 0] = l;
+            dst[i * 4 + 1] = l;
+            dst[i * 4 + 2] = l;
+            dst[i * 4 + 3] = a;
+        }
+    }
+
+    void expandRScalar(u8* rgba, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) {
+            u8 r = rgba[i * 4 + 0];
+            rgba[i * 4 + 1] = r;
+            rgba[i * 4 + 2] = r;
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    void lookupFloatScalar(const u8* src, float* dst, size_t count, const float* table)
+    {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            dst[i + 0] = table[src[i + 0]];
+            dst[i + 1] = table[256 + src[i + 1]];
+            dst[i + 2] = table[512 + src[i + 2]];
+            dst[i + 3] = table[768 + src[i + 3]];
+        }
+    }
+
+    void lookupHalfScalar(const u8* src, u16* dst, size_t count, const u16* table)
+    {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            dst[i + 0] = table[src[i + 0]];
+            dst[i + 1] = table[256 + src[i + 1]];
+            dst[i + 2] = table[512 + src[i + 2]];
+            dst[i + 3] = table[768 + src[i + 3]];
+        }
+    }
+
+#ifdef BFLIM_SIMD_X86
+
+    // SSE2
+
+    void expandL8SSE2(const u8* src, u8* dst, size_t count)
+    {
+        const __m128i alpha = _mm_set1_epi8((char)0xFF);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i l = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i llLo = _mm_unpacklo_epi8(l, l);
+            __m128i llHi = _mm_unpackhi_epi8(l, l);
+            __m128i laLo = _mm_unpacklo_epi8(l, alpha);
+            __m128i laHi = _mm_unpackhi_epi8(l, alpha);
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 0), _mm_unpacklo_epi16(llLo, laLo));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(llLo, laLo));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_unpacklo_epi16(llHi, laHi));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_unpackhi_epi16(llHi, laHi));
+        }
+        expandL8Scalar(src + i, dst + i * 4, count - i);
+    }
+
+    void expandLA8SSE2(const u8* src, u8* dst, size_t count)
+    {
+        const __m128i lowMask = _mm_set1_epi16(0x00FF);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i la = _mm_loadu_si128((const __m128i*)(src + i * 2));
+            __m128i l = _mm_and_si128(la, lowMask);
+            __m128i ll = _mm_or_si128(l, _mm_slli_epi16(l, 8));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 0), _mm_unpacklo_epi16(ll, la));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(ll, la));
+        }
+        expandLA8Scalar(src + i * 2, dst + i * 4, count - i);
+    }
+
+    void expandRSSE2(u8* rgba, size_t count)
+    {
+        const __m128i lowMask = _mm_set1_epi32(0x000000FF);
+        const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i px = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            __m128i r = _mm_and_si128(px, lowMask);
+            __m128i rrr = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(r, 8)), _mm_slli_epi32(r, 16));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(rrr, alpha));
+        }
+        expandRScalar(rgba + i * 4, count - i);
+    }
+
+    // SSSE3
+
+    BFLIM_TARGET("ssse3")
+    void expandL8SSSE3(const u8* src, u8* dst, size_t count)
+    {
+        const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        const __m128i shuffle0 = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+        const __m128i shuffle1 = _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+        const __m128i shuffle2 = _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1);
+        const __m128i shuffle3 = _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i l = _mm_loadu_si128((const __m128i*)(src + i));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 0), _mm_or_si128(_mm_shuffle_epi8(l, shuffle0), alpha));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_or_si128(_mm_shuffle_epi8(l, shuffle1), alpha));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_or_si128(_mm_shuffle_epi8(l, shuffle2), alpha));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_or_si128(_mm_shuffle_epi8(l, shuffle3), alpha));
+        }
+        expandL8Scalar(src + i, dst + i * 4, count - i);
+    }
+
+    BFLIM_TARGET("ssse3")
+    void expandLA8SSSE3(const u8* src, u8* dst, size_t count)
+    {
+        const __m128i shuffle0 = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+        const __m128i shuffle1 = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i la = _mm_loadu_si128((const __m128i*)(src + i * 2));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 0), _mm_shuffle_epi8(la, shuffle0));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_shuffle_epi8(la, shuffle1));
+        }
+        expandLA8Scalar(src + i * 2, dst + i * 4, count - i);
+    }
+
+    BFLIM_TARGET("ssse3")
+    void expandRSSSE3(u8* rgba, size_t count)
+    {
+        const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        const __m128i shuffle = _mm_setr_epi8(0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i px = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(_mm_shuffle_epi8(px, shuffle), alpha));
+        }
+        expandRScalar(rgba + i * 4, count - i);
+    }
+
+    // AVX2
+
+    BFLIM_TARGET("avx2")
+    void expandL8AVX2(const u8* src, u8* dst, size_t count)
+    {
+        const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+        const __m256i shuffle = _mm256_setr_epi8(0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1,
+                                                 0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i l = _mm_loadu_si128((const __m128i*)(src + i));
+            __m256i lo = _mm256_cvtepu8_epi32(l);
+            __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(l, 8));
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 0), _mm256_or_si256(_mm256_shuffle_epi8(lo, shuffle), alpha));
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 32), _mm256_or_si256(_mm256_shuffle_epi8(hi, shuffle), alpha));
+        }
+        expandL8Scalar(src + i, dst + i * 4, count - i);
+    }
+
+    BFLIM_TARGET("avx2")
+    void expandLA8AVX2(const u8* src, u8* dst, size_t count)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(0, 0, 0, 1, 4, 4, 4, 5, 8, 8, 8, 9, 12, 12, 12, 13,
+                                                 0, 0, 0, 1, 4, 4, 4, 5, 8, 8, 8, 9, 12, 12, 12, 13);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i laLo = _mm_loadu_si128((const __m128i*)(src + i * 2));
+            __m128i laHi = _mm_loadu_si128((const __m128i*)(src + i * 2 + 16));
+            __m256i lo = _mm256_cvtepu16_epi32(laLo);
+            __m256i hi = _mm256_cvtepu16_epi32(laHi);
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 0), _mm256_shuffle_epi8(lo, shuffle));
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 32), _mm256_shuffle_epi8(hi, shuffle));
+        }
+        expandLA8Scalar(src + i * 2, dst + i * 4, count - i);
+    }
+
+    BFLIM_TARGET("avx2")
+    void expandRAVX2(u8* rgba, size_t count)
+    {
+        const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+        const __m256i shuffle = _mm256_setr_epi8(0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1,
+                                                 0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i px = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+            _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(px, shuffle), alpha));
+        }
+        expandRScalar(rgba + i * 4, count - i);
+    }
+
+    // Two pixels per gather, the channel picks its quarter of the table
+    BFLIM_TARGET("avx2")
+    void lookupFloatAVX2(const u8* src, float* dst, size_t count, const float* table)
+    {
+        const __m256i channelOffset = _mm256_setr_epi32(0, 256, 512, 768, 0, 256, 512, 768);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            __m128i px = _mm_loadl_epi64((const __m128i*)(src + i * 4));
+            __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(px), channelOffset);
+            _mm256_storeu_ps(dst + i * 4, _mm256_i32gather_ps(table, index, 4));
+        }
+        lookupFloatScalar(src + i * 4, dst + i * 4, count - i, table);
+    }
+
+    // 32-bit gathers at 2-byte steps, the high half (next entry) is masked off
+    BFLIM_TARGET("avx2")
+    void lookupHalfAVX2(const u8* src, u16* dst, size_t count, const u16* table)
+    {
+        const __m256i channelOffset = _mm256_setr_epi32(0, 256, 512, 768, 0, 256, 512, 768);
+        const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            __m128i px = _mm_loadl_epi64((const __m128i*)(src + i * 4));
+            __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(px), channelOffset);
+            __m256i values = _mm256_and_si256(_mm256_i32gather_epi32((const int*)table, index, 2), lowMask);
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(values, values), 0x08);
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm256_castsi256_si128(packed));
+        }
+        lookupHalfScalar(src + i * 4, dst + i * 4, count - i, table);
+    }
+
+#endif
+
+    const BflimSimd::Kernels ScalarKernels = { expandL8Scalar, expandLA8Scalar, expandRScalar,
+                                               lookupFloatScalar, lookupHalfScalar };
+#ifdef BFLIM_SIMD_X86
+    // Table lookups need gathers, below AVX2 they stay scalar
+    const BflimSimd::Kernels SSE2Kernels = { expandL8SSE2, expandLA8SSE2, expandRSSE2,
+                                             lookupFloatScalar, lookupHalfScalar };
+    const BflimSimd::Kernels SSSE3Kernels = { expandL8SSSE3, expandLA8SSSE3, expandRSSSE3,
+                                              lookupFloatScalar, lookupHalfScalar };
+    const BflimSimd::Kernels AVX2Kernels = { expandL8AVX2, expandLA8AVX2, expandRAVX2,
+                                             lookupFloatAVX2, lookupHalfAVX2 };
+#endif
+
+    const BflimSimd::Kernels& kernelsForLevel(BflimSimd::Level level)
+    {
+        switch (level) {
+#ifdef BFLIM_SIMD_X86
+            case BflimSimd::Level::AVX2: return AVX2Kernels;
+            case BflimSimd::Level::SSSE3: return SSSE3Kernels;
+            case BflimSimd::Level::SSE2: return SSE2Kernels;
+#endif
+            default: return ScalarKernels;
+        }
+    }
+
+    BflimSimd::Level levelFromEnvironment(BflimSimd::Level detected)
+    {
+        const char* forced = std::getenv("BFLIM_SIMD");
+        if (!forced) return detected;
+
+        for (u8 i = 0; i <= (u8)BflimSimd::Level::AVX2; i++) {
+            BflimSimd::Level level = (BflimSimd::Level)i;
+            if (std::strcmp(forced, BflimSimd::getLevelName(level)) == 0) {
+                return level < detected ? level : detected;
+            }
+        }
+        return detected;
+    }
+
+    std::atomic<BflimSimd::Level>& currentLevel()
+    {
+        static std::atomic<BflimSimd::Level> level(levelFromEnvironment(BflimSimd::detectLevel()));
+        return level;
+    }
+}
+
+BflimSimd::Level BflimSimd::detectLevel()
+{
+#ifdef BFLIM_SIMD_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    if (avx2) return Level::AVX2;
+    if (ssse3) return Level::SSSE3;
+    if (sse2) return Level::SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("ssse3")) return Level::SSSE3;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+#endif
+#endif
+    return Level::Scalar;
+}
+
+BflimSimd::Level BflimSimd::getLevel()
+{
+    return currentLevel().load(std::memory_order_relaxed);
+}
+
+BflimSimd::Level BflimSimd::setLevel(Level level)
+{
+    Level detected = detectLevel();
+    if (level > detected) level = detected;
+    currentLevel().store(level, std::memory_order_relaxed);
+    return level;
+}
+
+const char* BflimSimd::getLevelName(Level level)
+{
+    switch (level) {
+        case Level::SSE2: return "sse2";
+        case Level::SSSE3: return "ssse3";
+        case Level::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+const BflimSimd::Kernels& BflimSimd::get()
+{
+    return kernelsForLevel(getLevel());
+}
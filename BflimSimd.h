@@ -0,0 +1,39 @@
+#pragma once
+#include <types.h>
+
+// Pixel expansion kernels used by the uncompressed and BC4/BC5 decoders, plus the
+// table lookups behind the linear/float decode output (BflimColor).
+// The implementation is picked once from the CPU features; BFLIM_SIMD=scalar|sse2|ssse3|avx2
+// in the environment or setLevel() force a lower level for testing.
+namespace BflimSimd
+{
+    enum class Level : u8
+    {
+        Scalar,
+        SSE2,
+        SSSE3,
+        AVX2
+    };
+
+    struct Kernels
+    {
+        // L -> L L L 255
+        void (*expandL8)(const u8* src, u8* dst, size_t count);
+        // L A -> L L L A
+        void (*expandLA8)(const u8* src, u8* dst, size_t count);
+        // R G B A -> R R R 255, in place
+        void (*expandR)(u8* rgba, size_t count);
+        // R G B A -> table[c * 256 + value] per channel c, 1024 entries
+        void (*lookupFloat)(const u8* src, float* dst, size_t count, const float* table);
+        // Same for 16-bit entries, the table needs one padding entry (1025) for the vector loads
+        void (*lookupHalf)(const u8* src, u16* dst, size_t count, const u16* table);
+    };
+
+    Level detectLevel();
+    Level getLevel();
+    // Clamped to detectLevel(), returns the level actually in use
+    Level setLevel(Level level);
+    const char* getLevelName(Level level);
+
+    const Kernels& get();
+}
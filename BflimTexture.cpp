@@ -0,0 +1,73 @@
+#include <BflimTexture.h>
+#include <BflimProfiler.h>
+#include <fstream>
+#include <iterator>
+
+BflimTexture::Ptr BflimTexture::create(std::vector<u8> data, std::string& error, BflimCache* cache)
+{
+    std::shared_ptr<BflimTexture> texture(new BflimTexture());
+    texture->mData = std::move(data);
+
+    if (!texture->mView.parse(texture->mData.data(), texture->mData.size())) {
+        error = "Not a BFLIM file";
+        return nullptr;
+    }
+
+    texture->mDecoder.parseImageInformation(texture->mView);
+    texture->mDecoder.setCache(cache);
+    return texture;
+}
+
+BflimTexture::Ptr BflimTexture::load(const std::string& path, std::string& error, BflimCache* cache)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "Cannot open " + path;
+        return nullptr;
+    }
+
+    std::vector<u8> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    BflimProfiler::countAllocation(data.size());
+    return create(std::move(data), error, cache);
+}
+
+size_t BflimTexture::getDecodedSize(const BflimDecodeOptions& options) const
+{
+    return mDecoder.getDecodedSize(options);
+}
+
+bool BflimTexture::decodeInto(u8* output, size_t outputSize, std::string& error, const BflimDecodeOptions& options,
+                              BflimScratch* scratch) const
+{
+    return mDecoder.decodeInto(getImageData(), getImageDataSize(), output, outputSize, options, error, scratch);
+}
+
+bool BflimTexture::decode(std::vector<u8>& output, std::string& error, const BflimDecodeOptions& options) const
+{
+    output.resize(getDecodedSize(options));
+    if (!decodeInto(output.data(), output.size(), error, options)) {
+        output.clear();
+        return false;
+    }
+    return true;
+}
+
+bool BflimTexture::decodeRegion(u32 x, u32 y, u32 width, u32 height, std::vector<u8>& output, std::string& error) const
+{
+    return mDecoder.decodeRegion(getImageData(), getImageDataSize(), x, y, width, height, output, error);
+}
+
+bool BflimTexture::decodePreview(u32 scale, std::vector<u8>& output, std::string& error) const
+{
+    return mDecoder.decodePreview(getImageData(), getImageDataSize(), scale, output, error);
+}
+
+bool BflimTexture::deswizzleElements(std::vector<u8>& elements, std::string& error) const
+{
+    return mDecoder.deswizzleElements(getImageData(), getImageDataSize(), elements, error);
+}
+
+std::vector<u8> BflimTexture::exportTexture(BflimContainer container, std::string& error) const
+{
+    return BflimExporter::exportTexture(mDecoder, getImageData(), getImageDataSize(), container, error);
+}
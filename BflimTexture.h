@@ -0,0 +1,69 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <types.h>
+#include <Bflim.h>
+#include <BflimExporter.h>
+#include <BflimView.h>
+
+// Parsed BFLIM that never changes once it is created. Every member is const and
+// reentrant, so one instance behind a shared_ptr can serve any number of threads
+// without locks. BflimEditor makes modified copies.
+class BflimTexture
+{
+public:
+    using Ptr = std::shared_ptr<const BflimTexture>;
+
+    // Takes over the whole file, nullptr (and error) if it is not a BFLIM.
+    // Decodes go through cache when one is given (BflimCache is thread safe).
+    static Ptr create(std::vector<u8> data, std::string& error, BflimCache* cache = nullptr);
+    static Ptr load(const std::string& path, std::string& error, BflimCache* cache = nullptr);
+
+    BflimTexture(const BflimTexture&) = delete;
+    BflimTexture& operator=(const BflimTexture&) = delete;
+
+    const BflimInfo& getInfo() const
+    {
+        return mView.getInfo();
+    }
+
+    const std::vector<u8>& getData() const
+    {
+        return mData;
+    }
+
+    const u8* getImageData() const
+    {
+        return mView.getImageData();
+    }
+
+    size_t getImageDataSize() const
+    {
+        return mView.getImageDataSize();
+    }
+
+    size_t getDecodedSize(const BflimDecodeOptions& options = BflimDecodeOptions()) const;
+    // A scratch arena must not be used by two threads at the same time
+    bool decodeInto(u8* output, size_t outputSize, std::string& error,
+                    const BflimDecodeOptions& options = BflimDecodeOptions(), BflimScratch* scratch = nullptr) const;
+    bool decode(std::vector<u8>& output, std::string& error,
+                const BflimDecodeOptions& options = BflimDecodeOptions()) const;
+    bool decodeRegion(u32 x, u32 y, u32 width, u32 height, std::vector<u8>& output, std::string& error) const;
+    bool decodePreview(u32 scale, std::vector<u8>& output, std::string& error) const;
+    bool deswizzleElements(std::vector<u8>& elements, std::string& error) const;
+    std::vector<u8> exportTexture(BflimContainer container, std::string& error) const;
+
+    // Parsed image information only (no payload copy), for the const Bflim API
+    const Bflim& getDecoder() const
+    {
+        return mDecoder;
+    }
+
+private:
+    BflimTexture() = default;
+
+    std::vector<u8> mData;
+    BflimView mView;
+    Bflim mDecoder;
+};
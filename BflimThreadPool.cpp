@@ -0,0 +1,110 @@
+#include <BflimThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    struct ParallelForJob
+    {
+        const std::function<void(u32)>* task;
+        u32 count;
+        std::atomic<u32> next{0};
+        std::atomic<u32> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        void run()
+        {
+            u32 completed = 0;
+            for (u32 i = next++; i < count; i = next++) {
+                (*task)(i);
+                completed++;
+            }
+
+            if (completed && done.fetch_add(completed) + completed == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    };
+}
+
+BflimThreadPool::BflimThreadPool(u32 threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (u32 i = 1; i < threadCount; i++) {
+        mWorkers.emplace_back(&BflimThreadPool::workerLoop, this);
+    }
+}
+
+BflimThreadPool::~BflimThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void BflimThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+            if (mJobs.empty()) return;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+        job();
+    }
+}
+
+void BflimThreadPool::parallelFor(u32 count, const std::function<void(u32)>& task)
+{
+    if (count == 0) return;
+
+    if (count == 1 || mWorkers.empty()) {
+        for (u32 i = 0; i < count; i++) task(i);
+        return;
+    }
+
+    auto job = std::make_shared<ParallelForJob>();
+    job->task = &task;
+    job->count = count;
+
+    u32 helpers = std::min<u32>((u32)mWorkers.size(), count - 1);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (u32 i = 0; i < helpers; i++) {
+            mJobs.emplace_back([job] { job->run(); });
+        }
+    }
+    mCondition.notify_all();
+
+    job->run();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job] { return job->done.load() == job->count; });
+}
+
+BflimExecutor BflimThreadPool::getExecutor()
+{
+    return [this](u32 count, const std::function<void(u32)>& task) { parallelFor(count, task); };
+}
+
+BflimThreadPool& BflimThreadPool::getDefault()
+{
+    static BflimThreadPool pool;
+    return pool;
+}
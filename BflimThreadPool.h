@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <types.h>
+
+// Runs task(i) for every i in [0, count) and returns once all of them finished.
+// Lets callers plug in their own scheduler instead of BflimThreadPool.
+using BflimExecutor = std::function<void(u32 count, const std::function<void(u32)>& task)>;
+
+class BflimThreadPool
+{
+public:
+    // 0 threads = std::thread::hardware_concurrency()
+    explicit BflimThreadPool(u32 threadCount = 0);
+    ~BflimThreadPool();
+
+    BflimThreadPool(const BflimThreadPool&) = delete;
+    BflimThreadPool& operator=(const BflimThreadPool&) = delete;
+
+    u32 getThreadCount() const
+    {
+        return (u32)mWorkers.size() + 1;
+    }
+
+    // The calling thread works on the range too, so nested calls cannot deadlock
+    void parallelFor(u32 count, const std::function<void(u32)>& task);
+
+    BflimExecutor getExecutor();
+
+    static BflimThreadPool& getDefault();
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mJobs;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStopping = false;
+};
@@ -0,0 +1,373 @@
+#include <BflimTiling.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace
+{
+    // Wii U (Latte) AddrLib configuration
+    constexpr u32 NumPipes = 2;
+    constexpr u32 NumBanks = 4;
+    constexpr u32 NumPipeBits = 1;
+    constexpr u32 NumBankBits = 2;
+    constexpr u32 NumGroupBits = 8;
+    constexpr u32 GroupSize = 256;
+    constexpr u32 SwapSize = 256;
+    constexpr u32 RowSize = 2048;
+    constexpr u32 SplitSize = 2048;
+
+    constexpr size_t MaxCachedMaps = 256;
+
+    using TileMapKey = std::tuple<u32, u32, u32, u32, u32>;
+
+    std::mutex sCacheMutex;
+    std::map<TileMapKey, std::shared_ptr<const GX2TileMap>> sCache;
+
+    bool isLinearTileMode(u32 tileMode)
+    {
+        return tileMode == GX2_TILE_MODE_DEFAULT || tileMode == GX2_TILE_MODE_LINEAR_ALIGNED ||
+               tileMode == GX2_TILE_MODE_LINEAR_SPECIAL;
+    }
+
+    bool isMicroTileMode(u32 tileMode)
+    {
+        return tileMode == GX2_TILE_MODE_1D_TILED_THIN1 || tileMode == GX2_TILE_MODE_1D_TILED_THICK;
+    }
+
+    bool isBankSwappedTileMode(u32 tileMode)
+    {
+        return tileMode == 8 || tileMode == 9 || tileMode == 10 || tileMode == 11 ||
+               tileMode == 14 || tileMode == 15;
+    }
+
+    // 1D/2D/2B/3D/3B_TILED_THICK, four slices per micro tile
+    bool isThickTileMode(u32 tileMode)
+    {
+        return tileMode == 3 || tileMode == 7 || tileMode == 11 || tileMode == 13 || tileMode == 15;
+    }
+
+    u32 computeSurfaceThickness(u32 tileMode)
+    {
+        return isThickTileMode(tileMode) ? 4 : 1;
+    }
+
+    u32 computeMacroTileAspectRatio(u32 tileMode)
+    {
+        switch (tileMode) {
+            case 5: case 9: return 2;
+            case 6: case 10: return 4;
+            default: return 1;
+        }
+    }
+
+    u32 computePixelIndexWithinMicroTile(u32 x, u32 y, u32 bpp)
+    {
+        u32 b[6];
+        switch (bpp) {
+            case 8:
+                b[0] = x & 1; b[1] = (x >> 1) & 1; b[2] = (x >> 2) & 1;
+                b[3] = (y >> 1) & 1; b[4] = y & 1; b[5] = (y >> 2) & 1;
+                break;
+            case 16:
+                b[0] = x & 1; b[1] = (x >> 1) & 1; b[2] = (x >> 2) & 1;
+                b[3] = y & 1; b[4] = (y >> 1) & 1; b[5] = (y >> 2) & 1;
+                break;
+            case 64:
+                b[0] = x & 1; b[1] = y & 1; b[2] = (x >> 1) & 1;
+                b[3] = (x >> 2) & 1; b[4] = (y >> 1) & 1; b[5] = (y >> 2) & 1;
+                break;
+            case 128:
+                b[0] = y & 1; b[1] = x & 1; b[2] = (x >> 1) & 1;
+                b[3] = (x >> 2) & 1; b[4] = (y >> 1) & 1; b[5] = (y >> 2) & 1;
+                break;
+            default: // 32 and 96
+                b[0] = x & 1; b[1] = (x >> 1) & 1; b[2] = y & 1;
+                b[3] = (x >> 2) & 1; b[4] = (y >> 1) & 1; b[5] = (y >> 2) & 1;
+                break;
+        }
+        return b[0] | (b[1] << 1) | (b[2] << 2) | (b[3] << 3) | (b[4] << 4) | (b[5] << 5);
+    }
+
+    u32 computeSurfaceBankSwappedWidth(u32 tileMode, u32 bpp, u32 pitch)
+    {
+        if (!isBankSwappedTileMode(tileMode)) return 0;
+
+        u32 numSamples = 1;
+        u32 bytesPerSample = 8 * bpp;
+        u32 samplesPerTile = SplitSize / bytesPerSample;
+        u32 slicesPerTile = samplesPerTile ? std::max(1u, numSamples / samplesPerTile) : 1;
+
+        if (isThickTileMode(tileMode)) numSamples = 4;
+
+        u32 bytesPerTileSlice = numSamples * bytesPerSample / slicesPerTile;
+        u32 factor = computeMacroTileAspectRatio(tileMode);
+        u32 swapTiles = std::max(1u, (SwapSize >> 1) / bpp);
+
+        u32 swapWidth = swapTiles * 8 * NumBanks;
+        u32 heightBytes = numSamples * factor * NumPipes * bpp / slicesPerTile;
+        u32 swapMax = NumPipes * NumBanks * RowSize / heightBytes;
+        u32 swapMin = GroupSize * 8 * NumBanks / bytesPerTileSlice;
+
+        u32 bankSwapWidth = std::min(swapMax, std::max(swapMin, swapWidth));
+        while (bankSwapWidth > 1 && bankSwapWidth >= 2 * pitch) {
+            bankSwapWidth >>= 1;
+        }
+        return bankSwapWidth;
+    }
+
+    // Address of element (x, y) in slice 0, sample 0 of a macro tiled surface
+    u32 computeSurfaceAddrFromCoordMacroTiled(u32 x, u32 y, u32 bpp, u32 pitch, u32 tileMode,
+                                              u32 pipeSwizzle, u32 bankSwizzle, u32 elemOffset)
+    {
+        u32 thickness = computeSurfaceThickness(tileMode);
+
+        u32 pipe = ((y >> 3) ^ (x >> 3)) & 1;
+        u32 bank = (((y >> 5) ^ (x >> 3)) & 1) | (2 * (((y >> 4) ^ (x >> 4)) & 1));
+
+        u32 bankPipe = pipe + NumPipes * bank;
+        u32 swizzle = pipeSwizzle + NumPipes * bankSwizzle;
+        bankPipe ^= swizzle;
+        bankPipe %= NumPipes * NumBanks;
+        pipe = bankPipe % NumPipes;
+        bank = bankPipe / NumPipes;
+
+        u32 macroTilePitch = 8 * NumBanks;
+        u32 macroTileHeight = 8 * NumPipes;
+        u32 aspectRatio = computeMacroTileAspectRatio(tileMode);
+        macroTilePitch /= aspectRatio;
+        macroTileHeight *= aspectRatio;
+
+        u32 macroTilesPerRow = pitch / macroTilePitch;
+        u32 macroTileBytes = (thickness * bpp * macroTileHeight * macroTilePitch + 7) / 8;
+        u32 macroTileIndexX = x / macroTilePitch;
+        u32 macroTileIndexY = y / macroTileHeight;
+        u32 macroTileOffset = (macroTileIndexX + macroTilesPerRow * macroTileIndexY) * macroTileBytes;
+
+        if (isBankSwappedTileMode(tileMode)) {
+            static const u32 bankSwapOrder[] = { 0, 1, 3, 2, 6, 7, 5, 4, 0, 0 };
+            u32 bankSwapWidth = computeSurfaceBankSwappedWidth(tileMode, bpp, pitch);
+            u32 swapIndex = macroTilePitch * macroTileIndexX / bankSwapWidth;
+            bank ^= bankSwapOrder[swapIndex & (NumBanks - 1)];
+        }
+
+        u32 groupMask = (1 << NumGroupBits) - 1;
+        u32 numSwizzleBits = NumBankBits + NumPipeBits;
+
+        u32 totalOffset = elemOffset + (macroTileOffset >> numSwizzleBits);
+        u32 offsetHigh = (totalOffset & ~groupMask) << numSwizzleBits;
+        u32 offsetLow = totalOffset & groupMask;
+
+        u32 pipeBits = pipe << NumGroupBits;
+        u32 bankBits = bank << (NumPipeBits + NumGroupBits);
+
+        return bankBits | pipeBits | offsetLow | offsetHigh;
+    }
+
+    struct TileCopyParams
+    {
+        const u32* microTileOffsets;
+        const u32* pixelOffsets;
+        u32 width;
+        u32 height;
+        u32 microTilesX;
+        u32 firstMicroTileY;
+        u32 lastMicroTileY;
+        u32 bytesPerElement;
+        u32 runElements;
+    };
+
+    // RunBytes == 0 selects the generic (runtime sized) copy
+    template <bool ToTiled, u32 RunBytes>
+    void copyTiles(const TileCopyParams& p, const u8* src, u8* dst)
+    {
+        const u32 bpe = p.bytesPerElement;
+        const u32 runBytes = RunBytes ? RunBytes : p.runElements * bpe;
+        const u32 runsPerRow = 8 / p.runElements;
+        const size_t linearPitch = (size_t)p.width * bpe;
+
+        for (u32 my = p.firstMicroTileY; my < p.lastMicroTileY; my++) {
+            const u32 y0 = my * 8;
+            const u32 rows = std::min(8u, p.height - y0);
+            const u32 linearY0 = y0 - p.firstMicroTileY * 8;
+
+            for (u32 mx = 0; mx < p.microTilesX; mx++) {
+                const u32 x0 = mx * 8;
+                const u32 cols = std::min(8u, p.width - x0);
+                const u32 base = p.microTileOffsets[my * p.microTilesX + mx];
+
+                for (u32 py = 0; py < rows; py++) {
+                    const u32* rowOffsets = p.pixelOffsets + py * 8;
+                    const size_t linearRow = (linearY0 + py) * linearPitch + (size_t)x0 * bpe;
+
+                    if (cols == 8) {
+                        for (u32 r = 0; r < runsPerRow; r++) {
+                            const size_t tiled = base + rowOffsets[r * p.runElements];
+                            const size_t linear = linearRow + (size_t)r * runBytes;
+                            if (ToTiled) std::memcpy(dst + tiled, src + linear, runBytes);
+                            else         std::memcpy(dst + linear, src + tiled, runBytes);
+                        }
+                    }
+                    else {
+                        for (u32 px = 0; px < cols; px++) {
+                            const size_t tiled = base + rowOffsets[px];
+                            const size_t linear = linearRow + (size_t)px * bpe;
+                            if (ToTiled) std::memcpy(dst + tiled, src + linear, bpe);
+                            else         std::memcpy(dst + linear, src + tiled, bpe);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    template <bool ToTiled>
+    void dispatchCopyTiles(const TileCopyParams& p, const u8* src, u8* dst)
+    {
+        switch (p.runElements * p.bytesPerElement) {
+            case 8:  copyTiles<ToTiled, 8>(p, src, dst); break;
+            case 16: copyTiles<ToTiled, 16>(p, src, dst); break;
+            case 32: copyTiles<ToTiled, 32>(p, src, dst); break;
+            default: copyTiles<ToTiled, 0>(p, src, dst); break;
+        }
+    }
+}
+
+bool GX2TileMap::isCompressed(GX2SurfaceFormat format)
+{
+    u32 hwFormat = format & 0x3F;
+    return hwFormat >= 0x31 && hwFormat <= 0x35;
+}
+
+u32 GX2TileMap::getBitsPerElement(GX2SurfaceFormat format)
+{
+    switch (format & 0x3F) {
+        case 0x01: case 0x02: return 8;
+        case 0x05: case 0x07: case 0x08: case 0x0A: case 0x0B: case 0x0C: return 16;
+        case 0x0D: case 0x0E: case 0x0F: case 0x10: case 0x11: case 0x12:
+        case 0x19: case 0x1A: case 0x1B: case 0x1C: return 32;
+        case 0x1D: case 0x1E: case 0x1F: return 64;
+        case 0x20: case 0x22: return 128;
+        case 0x31: case 0x34: return 64;
+        case 0x32: case 0x33: case 0x35: return 128;
+        default: return 32;
+    }
+}
+
+std::shared_ptr<const GX2TileMap> GX2TileMap::get(const GX2Surface& surface)
+{
+    TileMapKey key(surface.width, surface.height, surface.format, surface.tileMode, surface.swizzle);
+
+    {
+        std::lock_guard<std::mutex> lock(sCacheMutex);
+        auto it = sCache.find(key);
+        if (it != sCache.end()) return it->second;
+    }
+
+    auto map = std::make_shared<GX2TileMap>();
+    map->build(surface);
+
+    std::lock_guard<std::mutex> lock(sCacheMutex);
+    if (sCache.size() >= MaxCachedMaps) sCache.clear();
+    return sCache.emplace(key, std::move(map)).first->second;
+}
+
+void GX2TileMap::clearCache()
+{
+    std::lock_guard<std::mutex> lock(sCacheMutex);
+    sCache.clear();
+}
+
+void GX2TileMap::build(const GX2Surface& surface)
+{
+    GX2Surface surf = surface;
+    GX2CalcSurfaceSizeAndAlignment(&surf);
+
+    const u32 bpp = getBitsPerElement(surf.format);
+    const u32 tileMode = surf.tileMode;
+    const bool compressed = isCompressed(surf.format);
+
+    mWidth = compressed ? (surf.width + 3) / 4 : surf.width;
+    mHeight = compressed ? (surf.height + 3) / 4 : surf.height;
+    mBytesPerElement = bpp / 8;
+    mPitch = surf.pitch;
+    mImageSize = surf.imageSize;
+    mAlignment = surf.alignment;
+    mMicroTilesX = (mWidth + 7) / 8;
+    mMicroTilesY = (mHeight + 7) / 8;
+
+    const u32 pipeSwizzle = (surf.swizzle >> 8) & 1;
+    const u32 bankSwizzle = (surf.swizzle >> 9) & 3;
+    const u32 thickness = computeSurfaceThickness(tileMode);
+    const u32 microTileBytes = (64 * thickness * bpp + 7) / 8;
+
+    for (u32 py = 0; py < 8; py++) {
+        for (u32 px = 0; px < 8; px++) {
+            u32 offset;
+            if (isLinearTileMode(tileMode)) {
+                offset = (py * mPitch + px) * mBytesPerElement;
+            }
+            else {
+                offset = computePixelIndexWithinMicroTile(px, py, bpp) * bpp / 8;
+                if (!isMicroTileMode(tileMode)) {
+                    // Bytes past the first pipe interleave group move above the pipe/bank bits
+                    offset = (offset & (GroupSize - 1)) | ((offset & ~(GroupSize - 1)) << (NumBankBits + NumPipeBits));
+                }
+            }
+            mPixelOffsets[py * 8 + px] = offset;
+        }
+    }
+
+    // Longest run of elements that is contiguous in both layouts, for every row
+    mRunElements = 8;
+    while (mRunElements > 1) {
+        bool contiguous = true;
+        for (u32 i = 0; i < 64 && contiguous; i++) {
+            u32 start = i & ~(mRunElements - 1);
+            contiguous = mPixelOffsets[i] == mPixelOffsets[start] + (i - start) * mBytesPerElement;
+        }
+        if (contiguous) break;
+        mRunElements >>= 1;
+    }
+
+    mMicroTileOffsets.resize((size_t)mMicroTilesX * mMicroTilesY);
+    for (u32 my = 0; my < mMicroTilesY; my++) {
+        for (u32 mx = 0; mx < mMicroTilesX; mx++) {
+            u32 x = mx * 8;
+            u32 y = my * 8;
+            u32 offset;
+            if (isLinearTileMode(tileMode)) {
+                offset = (y * mPitch + x) * mBytesPerElement;
+            }
+            else if (isMicroTileMode(tileMode)) {
+                offset = microTileBytes * (mx + my * (mPitch >> 3));
+            }
+            else {
+                offset = computeSurfaceAddrFromCoordMacroTiled(x, y, bpp, mPitch, tileMode,
+                                                               pipeSwizzle, bankSwizzle, 0);
+            }
+            mMicroTileOffsets[my * mMicroTilesX + mx] = offset;
+        }
+    }
+}
+
+void GX2TileMap::deswizzle(const u8* tiled, u8* linear) const
+{
+    deswizzleRows(tiled, linear, 0, mMicroTilesY);
+}
+
+void GX2TileMap::deswizzleRows(const u8* tiled, u8* linear, u32 firstRow, u32 rowCount) const
+{
+    TileCopyParams params = { mMicroTileOffsets.data(), mPixelOffsets, mWidth, mHeight, mMicroTilesX,
+                              firstRow, std::min(firstRow + rowCount, mMicroTilesY),
+                              mBytesPerElement, mRunElements };
+    dispatchCopyTiles<false>(params, tiled, linear);
+}
+
+void GX2TileMap::swizzle(const u8* linear, u8* tiled) const
+{
+    TileCopyParams params = { mMicroTileOffsets.data(), mPixelOffsets, mWidth, mHeight, mMicroTilesX,
+                              0, mMicroTilesY, mBytesPerElement, mRunElements };
+    dispatchCopyTiles<true>(params, linear, tiled);
+}
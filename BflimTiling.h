@@ -0,0 +1,90 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <types.h>
+#include <ninTexUtils/gx2/gx2Surface.h>
+
+// Precomputed element address map for one GX2 surface geometry.
+// Mirrors the R600 AddrLib math used by GX2CopySurface, but computes it once per
+// micro tile (8x8 elements) instead of once per element, and copies whole
+// contiguous runs inside a micro tile at a time.
+class GX2TileMap
+{
+public:
+    // Returns the cached map for the surface's width/height/format/tileMode/swizzle,
+    // building it on first use. The surface does not need GX2CalcSurfaceSizeAndAlignment.
+    static std::shared_ptr<const GX2TileMap> get(const GX2Surface& surface);
+    static void clearCache();
+
+    // tiled -> tightly packed linear elements (getLinearSize() bytes)
+    void deswizzle(const u8* tiled, u8* linear) const;
+    // Deswizzles micro tile rows [firstRow, firstRow + rowCount) into a strip of
+    // rowCount * 8 linear element rows (the last strip may be shorter)
+    void deswizzleRows(const u8* tiled, u8* linear, u32 firstRow, u32 rowCount) const;
+    // linear -> tiled, only valid elements are written
+    void swizzle(const u8* linear, u8* tiled) const;
+
+    u32 getElementOffset(u32 x, u32 y) const
+    {
+        return mMicroTileOffsets[(y >> 3) * mMicroTilesX + (x >> 3)] + mPixelOffsets[(y & 7) * 8 + (x & 7)];
+    }
+
+    // Dimensions in elements (4x4 blocks for BCn formats)
+    u32 getWidth() const
+    {
+        return mWidth;
+    }
+
+    u32 getHeight() const
+    {
+        return mHeight;
+    }
+
+    u32 getMicroTilesY() const
+    {
+        return mMicroTilesY;
+    }
+
+    u32 getBytesPerElement() const
+    {
+        return mBytesPerElement;
+    }
+
+    u32 getPitch() const
+    {
+        return mPitch;
+    }
+
+    u32 getImageSize() const
+    {
+        return mImageSize;
+    }
+
+    u32 getAlignment() const
+    {
+        return mAlignment;
+    }
+
+    size_t getLinearSize() const
+    {
+        return (size_t)mWidth * mHeight * mBytesPerElement;
+    }
+
+    static bool isCompressed(GX2SurfaceFormat format);
+    static u32 getBitsPerElement(GX2SurfaceFormat format);
+
+private:
+    void build(const GX2Surface& surface);
+
+    u32 mWidth = 0;
+    u32 mHeight = 0;
+    u32 mBytesPerElement = 0;
+    u32 mPitch = 0;
+    u32 mImageSize = 0;
+    u32 mAlignment = 0;
+    u32 mMicroTilesX = 0;
+    u32 mMicroTilesY = 0;
+    u32 mRunElements = 1;
+    std::vector<u32> mMicroTileOffsets;
+    u32 mPixelOffsets[64];
+};
@@ -0,0 +1,209 @@
+#include <BflimView.h>
+#include <BinaryUtils.h>
+#include <BflimCtr.h>
+#include <BflimProfiler.h>
+#include <fstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool BflimView::probe(const u8* tail, size_t tailSize, size_t fileSize, BflimInfo& info)
+{
+    if (tail == nullptr || tailSize < ProbeSize || tailSize > fileSize) return false;
+
+    const size_t headerOffset = tailSize - ProbeSize;
+    const u8* header = tail + headerOffset;
+    if (header[0] != 'F' || header[1] != 'L' || header[2] != 'I' || header[3] != 'M') {
+        return false;
+    }
+
+    // The byte order mark tells the platform: FE FF on the Wii U, FF FE (little endian) on the 3DS
+    const bool littleEndian = header[4] == 0xFF && header[5] == 0xFE;
+    auto read16 = [littleEndian](const u8* p) -> u16 { return littleEndian ? (u16)(p[0] | (p[1] << 8)) : Read16(p); };
+    auto read32 = [littleEndian](const u8* p) -> u32 {
+        return littleEndian ? (u32)(p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24)) : Read32(p);
+    };
+
+    // imag follows the FLIM header, whose size is stored in it
+    const u8* imag = header + read16(header + 6);
+    if (imag + 0x14 > tail + tailSize || imag[0] != 'i' || imag[1] != 'm' || imag[2] != 'a' || imag[3] != 'g') {
+        return false;
+    }
+
+    info = BflimInfo();
+    info.platform = littleEndian ? BflimPlatform::CTR : BflimPlatform::WiiU;
+    info.width = read16(imag + 0x08);
+    info.height = read16(imag + 0x0A);
+    info.imageSize = read32(imag + 0x10);
+    info.version = read32(header + 0x08);
+    info.alignment = read16(imag + 0x0C);
+    info.fileSize = fileSize;
+    info.formatId = imag[0x0E];
+
+    if (info.platform == BflimPlatform::CTR) {
+        // 3DS format numbers differ from 0x0C on, unknown ones keep the raw value
+        info.format = BflimCtr::toFormatId(imag[0x0E], info.formatId) ? BflimConstants::findFormat(info.formatId) : nullptr;
+
+        // No GX2 tile modes, the last byte holds the 3DS rotation flags
+        info.tileMode = 0;
+        info.swizzle = imag[0x0F];
+    }
+    else {
+        info.format = BflimConstants::findFormat(info.formatId);
+        info.tileMode = imag[0x0F] & 0x1F;
+        info.swizzle = (imag[0x0F] >> 5) & 0x07;
+    }
+    return true;
+}
+
+bool BflimView::probeFile(const std::string& path, BflimInfo& info)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    std::streamoff fileSize = file.tellg();
+    if (fileSize < (std::streamoff)ProbeSize) return false;
+
+    u8 tail[ProbeSize];
+    file.seekg(fileSize - (std::streamoff)ProbeSize);
+    if (!file.read(reinterpret_cast<char*>(tail), ProbeSize)) return false;
+
+    return probe(tail, ProbeSize, (size_t)fileSize, info);
+}
+
+bool BflimView::parse(const u8* data, size_t size)
+{
+    BflimProfiler::Scope scope(BflimProfiler::Stage::Parse, ProbeSize);
+
+    mData = nullptr;
+    mSize = 0;
+
+    if (data == nullptr || size < ProbeSize) return false;
+    if (!probe(data + size - ProbeSize, ProbeSize, size, mInfo)) return false;
+
+    mData = data;
+    mSize = size;
+    mImageDataSize = size - ProbeSize;
+    return true;
+}
+
+BflimMappedFile::~BflimMappedFile()
+{
+    close();
+}
+
+BflimMappedFile::BflimMappedFile(BflimMappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+BflimMappedFile& BflimMappedFile::operator=(BflimMappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        mData = std::exchange(other.mData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+#ifdef _WIN32
+        mFile = std::exchange(other.mFile, nullptr);
+        mMapping = std::exchange(other.mMapping, nullptr);
+#else
+        mFd = std::exchange(other.mFd, -1);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool BflimMappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFile = file;
+    mMapping = mapping;
+    mData = static_cast<const u8*>(view);
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void BflimMappedFile::close()
+{
+    if (mData) UnmapViewOfFile(mData);
+    if (mMapping) CloseHandle(mMapping);
+    if (mFile) CloseHandle(mFile);
+
+    mData = nullptr;
+    mSize = 0;
+    mMapping = nullptr;
+    mFile = nullptr;
+}
+
+#else
+
+bool BflimMappedFile::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    mFd = fd;
+    mData = static_cast<const u8*>(view);
+    mSize = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void BflimMappedFile::close()
+{
+    if (mData) munmap(const_cast<u8*>(mData), mSize);
+    if (mFd >= 0) ::close(mFd);
+
+    mData = nullptr;
+    mSize = 0;
+    mFd = -1;
+}
+
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+#include <string>
+#include <types.h>
+#include <BflimFormats.h>
+
+enum class BflimPlatform : u8
+{
+    WiiU,   // big endian, GX2 tiling
+    CTR     // 3DS, little endian, Morton tiling (see BflimCtr.h)
+};
+
+// Metadata from the FLIM/imag footer, everything a probe returns
+struct BflimInfo
+{
+    BflimPlatform platform = BflimPlatform::WiiU;
+    u16 width = 0;
+    u16 height = 0;
+    // SupportedFormats ID (3DS format numbers are translated)
+    u8 formatId = 0;
+    // nullptr if the format ID is not in BflimConstants::SupportedFormats
+    const Format* format = nullptr;
+    u8 tileMode = 0;
+    u8 swizzle = 0;
+    // Image size stored in the imag block
+    u32 imageSize = 0;
+    // FLIM header version and imag alignment, kept when a file is rewritten
+    u32 version = 0;
+    u16 alignment = 0;
+    size_t fileSize = 0;
+};
+
+// Non-owning view over a BFLIM file that lives somewhere else (a caller
+// buffer or a BflimMappedFile). Parsing only reads the footer, nothing is copied.
+class BflimView
+{
+public:
+    // Bytes from the end of a file a probe needs: the FLIM header and the imag block
+    static constexpr size_t ProbeSize = 0x28;
+
+    // Reads the footer from the last ProbeSize (or more) bytes of a file, without the payload
+    static bool probe(const u8* tail, size_t tailSize, size_t fileSize, BflimInfo& info);
+    // Reads only the tail of the file from disk
+    static bool probeFile(const std::string& path, BflimInfo& info);
+
+    bool parse(const u8* data, size_t size);
+
+    const BflimInfo& getInfo() const
+    {
+        return mInfo;
+    }
+
+    bool isValid() const
+    {
+        return mData != nullptr;
+    }
+
+    const u8* getData() const
+    {
+        return mData;
+    }
+
+    size_t getSize() const
+    {
+        return mSize;
+    }
+
+    // Everything in front of the 0x28 byte FLIM/imag footer
+    const u8* getImageData() const
+    {
+        return mData;
+    }
+
+    size_t getImageDataSize() const
+    {
+        return mImageDataSize;
+    }
+
+    u16 getImageWidth() const
+    {
+        return mInfo.width;
+    }
+
+    u16 getImageHeight() const
+    {
+        return mInfo.height;
+    }
+
+    u8 getFormatId() const
+    {
+        return mInfo.formatId;
+    }
+
+    // nullptr if the format ID is not in BflimConstants::SupportedFormats
+    const Format* getImageFormat() const
+    {
+        return mInfo.format;
+    }
+
+    BflimPlatform getPlatform() const
+    {
+        return mInfo.platform;
+    }
+
+    // Always 0 for 3DS files
+    u8 getTileMode() const
+    {
+        return mInfo.tileMode;
+    }
+
+    u8 getSwizzle() const
+    {
+        return mInfo.swizzle;
+    }
+
+    u8 getPipeSwizzle() const
+    {
+        return (mInfo.swizzle >> 0) & 0x01;
+    }
+
+    u8 getBankSwizzle() const
+    {
+        return (mInfo.swizzle >> 1) & 0x03;
+    }
+
+private:
+    const u8* mData = nullptr;
+    size_t mSize = 0;
+    size_t mImageDataSize = 0;
+    BflimInfo mInfo;
+};
+
+// Read-only memory mapping of a whole file, meant to back a BflimView
+class BflimMappedFile
+{
+public:
+    BflimMappedFile() = default;
+    ~BflimMappedFile();
+
+    BflimMappedFile(const BflimMappedFile&) = delete;
+    BflimMappedFile& operator=(const BflimMappedFile&) = delete;
+    BflimMappedFile(BflimMappedFile&& other) noexcept;
+    BflimMappedFile& operator=(BflimMappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    const u8* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    const u8* mData = nullptr;
+    size_t mSize = 0;
+#ifdef _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#else
+    int mFd = -1;
+#endif
+};
@@ -0,0 +1,227 @@
+#include <BflimWriter.h>
+#include <Bflim.h>
+#include <BflimCtr.h>
+#include <BflimFormats.h>
+#include <BflimTiling.h>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    std::string describe(const BflimImageDesc& desc)
+    {
+        char buffer[96];
+        std::snprintf(buffer, sizeof(buffer), "%ux%u, format 0x%02X, tile mode %u", desc.width, desc.height,
+                      desc.formatId, desc.tileMode);
+        return buffer;
+    }
+
+    // 3DS BFLIMs align their image data to 128 bytes
+    constexpr u16 CtrAlignment = 0x80;
+
+    class FooterWriter
+    {
+    public:
+        FooterWriter(u8* data, bool littleEndian)
+            : mData(data), mLittleEndian(littleEndian)
+        {
+        }
+
+        void bytes(const char* value, size_t count)
+        {
+            std::memcpy(mData, value, count);
+            mData += count;
+        }
+
+        void u8Value(u8 value)
+        {
+            *mData++ = value;
+        }
+
+        void u16Value(u16 value)
+        {
+            mData[mLittleEndian ? 0 : 1] = (u8)value;
+            mData[mLittleEndian ? 1 : 0] = (u8)(value >> 8);
+            mData += 2;
+        }
+
+        void u32Value(u32 value)
+        {
+            for (u32 i = 0; i < 4; i++) {
+                mData[mLittleEndian ? i : 3 - i] = (u8)(value >> (i * 8));
+            }
+            mData += 4;
+        }
+
+    private:
+        u8* mData;
+        bool mLittleEndian;
+    };
+
+    bool isWiiUEncodable(const BflimImageDesc& desc)
+    {
+        // encodeInto only handles the tiled modes
+        return desc.tileMode >= 2 && desc.tileMode <= 15 && BflimEncoders::get(desc.formatId).encode;
+    }
+}
+
+BflimImageDesc BflimImageDesc::fromInfo(const BflimInfo& info)
+{
+    BflimImageDesc desc;
+    desc.platform = info.platform;
+    desc.width = info.width;
+    desc.height = info.height;
+    desc.formatId = info.formatId;
+    desc.tileMode = info.tileMode;
+    desc.swizzle = info.swizzle;
+    desc.version = info.version;
+    return desc;
+}
+
+size_t BflimWriter::getImageSize(const BflimImageDesc& desc)
+{
+    const Format* format = BflimConstants::findFormat(desc.formatId);
+    if (!format || desc.width == 0 || desc.height == 0) return 0;
+
+    if (desc.platform == BflimPlatform::CTR) {
+        return BflimCtr::toCtrFormat(desc.formatId) == 0xFF ? 0 : BflimCtr::getImageSize(desc.formatId, desc.width, desc.height);
+    }
+
+    if (format->mGX2Format == GX2_SURFACE_FORMAT_INVALID || desc.tileMode > 15) return 0;
+    GX2Surface surface = Bflim::createGX2Surface(desc.width, desc.height, desc.formatId, desc.tileMode, desc.swizzle);
+    return GX2TileMap::get(surface)->getImageSize();
+}
+
+size_t BflimWriter::getFileSize(const BflimImageDesc& desc)
+{
+    size_t imageSize = getImageSize(desc);
+    return imageSize ? imageSize + BflimView::ProbeSize : 0;
+}
+
+bool BflimWriter::write(const BflimImageDesc& desc, const u8* imageData, size_t imageSize, u8* output,
+                        size_t outputSize, std::string& error)
+{
+    size_t surfaceSize;
+    if (!validate(desc, outputSize, surfaceSize, error)) return false;
+
+    if (imageData == nullptr || imageSize < surfaceSize) {
+        error = "Image data smaller than surface size!";
+        return false;
+    }
+
+    std::memcpy(output, imageData, surfaceSize);
+    writeFooter(desc, surfaceSize, output + surfaceSize);
+    return true;
+}
+
+bool BflimWriter::writeRGBA(const BflimImageDesc& desc, const u8* rgbaData, size_t rgbaSize, u8* output,
+                            size_t outputSize, std::string& error, const BflimEncodeOptions& options)
+{
+    size_t imageSize;
+    if (!validate(desc, outputSize, imageSize, error)) return false;
+
+    const bool encodable = desc.platform == BflimPlatform::CTR ? BflimCtr::isEncodable(desc.formatId) : isWiiUEncodable(desc);
+    if (!encodable) {
+        error = "Cannot encode " + describe(desc) + "!";
+        return false;
+    }
+
+    // The footer goes first so the finished file can be parsed like any other
+    writeFooter(desc, imageSize, output + imageSize);
+
+    BflimView view;
+    if (!view.parse(output, imageSize + BflimView::ProbeSize)) {
+        error = "Cannot parse the written header!";
+        return false;
+    }
+
+    Bflim bflim;
+    bflim.parseImageInformation(view);
+    bflim.setEncodeOptions(options);
+
+    if (desc.platform == BflimPlatform::WiiU) {
+        // Tiled encodes only write texels, clear the surface padding if there is any
+        std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(bflim.createGX2Surface());
+        if (tileMap->getLinearSize() < imageSize) {
+            std::memset(output, 0, imageSize);
+        }
+    }
+
+    return bflim.encodeInto(rgbaData, rgbaSize, output, imageSize, error);
+}
+
+bool BflimWriter::writeHeader(const BflimImageDesc& desc, u8* output, size_t outputSize, std::string& error)
+{
+    size_t imageSize;
+    if (!validate(desc, outputSize, imageSize, error)) return false;
+
+    writeFooter(desc, imageSize, output + imageSize);
+    return true;
+}
+
+std::vector<u8> BflimWriter::writeRGBA(const BflimImageDesc& desc, const std::vector<u8>& rgbaData, std::string& error,
+                                       const BflimEncodeOptions& options)
+{
+    std::vector<u8> output(getFileSize(desc));
+    if (!writeRGBA(desc, rgbaData.data(), rgbaData.size(), output.data(), output.size(), error, options)) {
+        return std::vector<u8>();
+    }
+    return output;
+}
+
+bool BflimWriter::validate(const BflimImageDesc& desc, size_t outputSize, size_t& imageSize, std::string& error)
+{
+    imageSize = getImageSize(desc);
+    if (imageSize == 0) {
+        error = "Unsupported layout: " + describe(desc);
+        return false;
+    }
+
+    if (imageSize + BflimView::ProbeSize > 0xFFFFFFFF) {
+        error = "Image too large for a BFLIM!";
+        return false;
+    }
+
+    if (outputSize < imageSize + BflimView::ProbeSize) {
+        error = "Output buffer smaller than the file (" + std::to_string(imageSize + BflimView::ProbeSize) + " bytes)!";
+        return false;
+    }
+    return true;
+}
+
+void BflimWriter::writeFooter(const BflimImageDesc& desc, size_t imageSize, u8* footer)
+{
+    const bool ctr = desc.platform == BflimPlatform::CTR;
+    FooterWriter writer(footer, ctr);
+
+    u16 alignment = CtrAlignment;
+    u8 format = desc.formatId;
+    u8 flags = desc.swizzle;
+    if (ctr) {
+        format = BflimCtr::toCtrFormat(desc.formatId);
+    }
+    else {
+        GX2Surface surface = Bflim::createGX2Surface(desc.width, desc.height, desc.formatId, desc.tileMode, desc.swizzle);
+        alignment = (u16)GX2TileMap::get(surface)->getAlignment();
+        flags = (u8)((desc.tileMode & 0x1F) | ((desc.swizzle & 0x07) << 5));
+    }
+
+    // FLIM header
+    writer.bytes("FLIM", 4);
+    writer.u16Value(0xFEFF);
+    writer.u16Value(0x14);
+    writer.u32Value(desc.version ? desc.version : DefaultVersion);
+    writer.u32Value((u32)(imageSize + BflimView::ProbeSize));
+    writer.u16Value(1);
+    writer.u16Value(0);
+
+    // imag block
+    writer.bytes("imag", 4);
+    writer.u32Value(0x10);
+    writer.u16Value(desc.width);
+    writer.u16Value(desc.height);
+    writer.u16Value(alignment);
+    writer.u8Value(format);
+    writer.u8Value(flags);
+    writer.u32Value((u32)imageSize);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <types.h>
+#include <BflimView.h>
+#include <BflimEncoders.h>
+
+// Layout of a BFLIM to write. tileMode is ignored for the 3DS, where swizzle holds
+// the rotation flags instead.
+struct BflimImageDesc
+{
+    BflimPlatform platform = BflimPlatform::WiiU;
+    u16 width = 0;
+    u16 height = 0;
+    // SupportedFormats ID, translated for 3DS files
+    u8 formatId = 0x09;
+    // GX2_TILE_MODE_TILED_2D_THIN1, what most Wii U layouts use
+    u8 tileMode = 4;
+    u8 swizzle = 0;
+    // FLIM header version, 0 = DefaultVersion
+    u32 version = 0;
+
+    // Same layout as an existing file
+    static BflimImageDesc fromInfo(const BflimInfo& info);
+};
+
+// Builds complete BFLIM files (payload followed by the FLIM header and imag block)
+// in a caller buffer of getFileSize() bytes, so textures can change size, format or
+// tile mode without going through temporary files.
+class BflimWriter
+{
+public:
+    static constexpr u32 DefaultVersion = 0x02020000;
+
+    // Payload bytes (the tiled surface), 0 if the layout cannot be written
+    static size_t getImageSize(const BflimImageDesc& desc);
+    static size_t getFileSize(const BflimImageDesc& desc);
+
+    // imageData is getImageSize() bytes already in the stored layout
+    static bool write(const BflimImageDesc& desc, const u8* imageData, size_t imageSize, u8* output,
+                      size_t outputSize, std::string& error);
+    // Encodes width * height RGBA8 pixels straight into the payload of output
+    static bool writeRGBA(const BflimImageDesc& desc, const u8* rgbaData, size_t rgbaSize, u8* output,
+                          size_t outputSize, std::string& error,
+                          const BflimEncodeOptions& options = BflimEncodeOptions());
+
+    static std::vector<u8> writeRGBA(const BflimImageDesc& desc, const std::vector<u8>& rgbaData, std::string& error,
+                                     const BflimEncodeOptions& options = BflimEncodeOptions());
+    // Only the FLIM header and imag block at output + getImageSize(), the payload is left as is
+    static bool writeHeader(const BflimImageDesc& desc, u8* output, size_t outputSize, std::string& error);
+
+private:
+    static bool validate(const BflimImageDesc& desc, size_t outputSize, size_t& imageSize, std::string& error);
+    // FLIM header and imag block, BflimView::ProbeSize bytes
+    static void writeFooter(const BflimImageDesc& desc, size_t imageSize, u8* footer);
+};
@@ -0,0 +1,407 @@
+// Benchmarks every stage of the library on synthetic BFLIMs.
+//
+//   BflimBench [--json file] [--csv file] [--min-time ms] [--repeats n]
+//              [--min-size n] [--max-size n] [--format id] [--tile-mode n]
+//
+// Every combination of the Wii U formats in BflimConstants::SupportedFormats,
+// tile modes 0/1/2/4 and square sizes 64..4096 gets its own fixed pseudo random
+// payload, so runs are comparable across versions. Each stage (parse, deswizzle, decode, the fused
+// getDeswizzledRGBA path, encode, swizzle, the fused encodeInto path) is timed
+// separately and reported as the median of several repeats. Deswizzle/decode go
+// through Bflim::deswizzleElements, so BCn in linear tile modes is covered; encode
+// runs the BflimEncoders codec of every encodable format over the whole image.
+
+#include <Bflim.h>
+#include <BflimEncoders.h>
+#include <BflimFormats.h>
+#include <BflimScratch.h>
+#include <BflimSimd.h>
+#include <BflimTiling.h>
+#include <BflimView.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        std::string jsonPath;
+        std::string csvPath;
+        double minTimeMs = 200.0;
+        u32 repeats = 5;
+        u32 minSize = 64;
+        u32 maxSize = 4096;
+        int formatFilter = -1;
+        int tileModeFilter = -1;
+    };
+
+    struct Result
+    {
+        u8 formatId;
+        std::string formatName;
+        u8 tileMode;
+        u32 width;
+        u32 height;
+        std::string stage;
+        u64 iterations;
+        size_t bytes;
+        double nsPerIteration;
+    };
+
+    // xorshift64*, seeded per texture so the payload only depends on its parameters
+    struct Random
+    {
+        u64 state;
+
+        explicit Random(u64 seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+        u64 next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+
+        void fill(std::vector<u8>& data)
+        {
+            for (size_t i = 0; i < data.size(); i += 8) {
+                u64 value = next();
+                std::memcpy(&data[i], &value, std::min<size_t>(8, data.size() - i));
+            }
+        }
+    };
+
+    void put16(std::vector<u8>& data, size_t offset, u16 value)
+    {
+        data[offset + 0] = value >> 8;
+        data[offset + 1] = value & 0xFF;
+    }
+
+    void put32(std::vector<u8>& data, size_t offset, u32 value)
+    {
+        data[offset + 0] = value >> 24;
+        data[offset + 1] = (value >> 16) & 0xFF;
+        data[offset + 2] = (value >> 8) & 0xFF;
+        data[offset + 3] = value & 0xFF;
+    }
+
+    // Big endian (Wii U) FLIM header + imag block behind the payload
+    std::vector<u8> makeBflim(const std::vector<u8>& payload, u16 width, u16 height, u8 formatId, u8 tileMode)
+    {
+        std::vector<u8> file(payload);
+        size_t header = file.size();
+        file.resize(header + 0x28);
+
+        std::memcpy(&file[header], "FLIM", 4);
+        put16(file, header + 0x04, 0xFEFF);
+        put16(file, header + 0x06, 0x14);
+        put32(file, header + 0x08, 0x02020000);
+        put32(file, header + 0x0C, (u32)file.size());
+        put16(file, header + 0x10, 1);
+
+        size_t imag = header + 0x14;
+        std::memcpy(&file[imag], "imag", 4);
+        put32(file, imag + 0x04, 0x10);
+        put16(file, imag + 0x08, width);
+        put16(file, imag + 0x0A, height);
+        put16(file, imag + 0x0C, 0x2000);
+        file[imag + 0x0E] = formatId;
+        file[imag + 0x0F] = tileMode;
+        put32(file, imag + 0x10, (u32)payload.size());
+        return file;
+    }
+
+    std::vector<u8> makeSyntheticBflim(u16 width, u16 height, u8 formatId, u8 tileMode)
+    {
+        // Parse a header-only file first to size the surface
+        Bflim probe;
+        probe.parseBinary(makeBflim(std::vector<u8>(0x40), width, height, formatId, tileMode));
+        std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(probe.createGX2Surface());
+
+        size_t linearSize = (size_t)width * height * 4;
+        std::vector<u8> payload(std::max<size_t>(tileMap->getImageSize(), linearSize));
+        Random(((u64)formatId << 40) | ((u64)tileMode << 32) | ((u64)width << 16) | height).fill(payload);
+        return makeBflim(payload, width, height, formatId, tileMode);
+    }
+
+    template <typename T>
+    void doNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    double measure(const Options& options, u64& iterations, const std::function<void()>& body)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // Warm up and calibrate the iteration count for one repeat
+        auto start = Clock::now();
+        body();
+        double once = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        double perRepeatNs = options.minTimeMs * 1e6 / options.repeats;
+        iterations = std::max<u64>(1, (u64)(perRepeatNs / std::max(once, 1.0)));
+
+        std::vector<double> samples;
+        for (u32 r = 0; r < options.repeats; r++) {
+            start = Clock::now();
+            for (u64 i = 0; i < iterations; i++) body();
+            samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    bool canEncode(const Format& format)
+    {
+        return BflimEncoders::get(format.mId).encode != nullptr && format.mGX2Format != GX2_SURFACE_FORMAT_INVALID;
+    }
+
+    // Serial codec pass over the whole image into packed elements
+    void encodeElements(const Bflim& bflim, const Format& format, const std::vector<u8>& rgba, u32 size,
+                        std::vector<u8>& elements)
+    {
+        const BflimEncoders::Encoder encode = BflimEncoders::get(format.mId).encode;
+        const BflimEncodeQuality quality = bflim.getEncodeOptions().quality;
+        const u32 blockDim = format.mBlockDim;
+        const size_t elementBytes = format.mBPP * blockDim * blockDim / 8;
+        u8 block[16 * 4];
+
+        u8* element = elements.data();
+        for (u32 y = 0; y < size; y += blockDim) {
+            for (u32 x = 0; x < size; x += blockDim) {
+                if (blockDim == 1) {
+                    encode(&rgba[((size_t)y * size + x) * 4], element, quality);
+                }
+                else {
+                    bflim.fillBlock(rgba.data(), block, x, y);
+                    encode(block, element, quality);
+                }
+                element += elementBytes;
+            }
+        }
+    }
+
+    void benchTexture(const Options& options, const Format& format, u8 tileMode, u32 size, std::vector<Result>& results)
+    {
+        const std::vector<u8> file = makeSyntheticBflim(size, size, format.mId, tileMode);
+
+        Bflim bflim;
+        bflim.parseBinary(file);
+        const u8* payload = bflim.getImageDataPtr();
+        const size_t payloadSize = bflim.getImageDataSize();
+        const size_t rgbaSize = (size_t)size * size * 4;
+
+        auto record = [&](const char* stage, size_t bytes, const std::function<void()>& body) {
+            Result result = { format.mId, format.mName, tileMode, size, size, stage, 0, bytes, 0.0 };
+            result.nsPerIteration = measure(options, result.iterations, body);
+            results.push_back(result);
+
+            std::fprintf(stderr, "%-22s tile %2u %4ux%-4u %-10s %10.1f MB/s %8.3f ns/px\n",
+                         format.mName, tileMode, size, size, stage,
+                         bytes / result.nsPerIteration * 1e3, result.nsPerIteration / ((double)size * size));
+        };
+
+        record("parse", file.size(), [&] {
+            BflimView view;
+            view.parse(file.data(), file.size());
+            Bflim parsed;
+            parsed.parseImageInformation(view);
+            doNotOptimize(parsed);
+        });
+
+        // Texels or BCn blocks in row-major order, for every tile mode
+        std::vector<u8> linear;
+        std::string error;
+        if (bflim.deswizzleElements(payload, payloadSize, linear, error)) {
+            record("deswizzle", payloadSize, [&] {
+                std::vector<u8> out;
+                bflim.deswizzleElements(payload, payloadSize, out, error);
+                doNotOptimize(out);
+            });
+        }
+        else {
+            std::fprintf(stderr, "%-22s tile %2u %4ux%-4u no deswizzle: %s\n", format.mName, tileMode, size, size,
+                         error.c_str());
+        }
+
+        if (bflim.isDecodable() && !linear.empty()) {
+            std::vector<u8> rgba(rgbaSize);
+            record("decode", linear.size(), [&] {
+                bflim.decodeLinear(linear.data(), rgba.data(), size, size);
+                doNotOptimize(rgba);
+            });
+
+            record("full", payloadSize, [&] {
+                std::vector<u8> out;
+                bflim.decodeRGBA(payload, payloadSize, out, error);
+                doNotOptimize(out);
+            });
+        }
+
+        if (canEncode(format) && !linear.empty()) {
+            std::vector<u8> rgba(rgbaSize);
+            Random(size).fill(rgba);
+
+            std::vector<u8> encoded(linear.size());
+            record("encode", rgbaSize, [&] {
+                encodeElements(bflim, format, rgba, size, encoded);
+                doNotOptimize(encoded);
+            });
+
+            if (tileMode >= 2) {
+                record("swizzle", encoded.size(), [&] {
+                    std::vector<u8> out = bflim.swizzleMacroTiled(encoded);
+                    doNotOptimize(out);
+                });
+
+                // Parallel block encode written straight to the tiled offsets
+                std::vector<u8> tiled(bflim.getEncodedSize());
+                BflimScratch scratch;
+                if (bflim.encodeInto(rgba.data(), rgba.size(), tiled.data(), tiled.size(), error, &scratch)) {
+                    record("encodeInto", rgbaSize, [&] {
+                        bflim.encodeInto(rgba.data(), rgba.size(), tiled.data(), tiled.size(), error, &scratch);
+                        doNotOptimize(tiled);
+                    });
+                }
+            }
+        }
+    }
+
+    std::string jsonEscape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    std::string compilerName()
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+
+    void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results)
+    {
+        out << "{\n  \"meta\": {";
+        out << "\"compiler\": \"" << jsonEscape(compilerName()) << "\", ";
+        out << "\"simd\": \"" << BflimSimd::getLevelName(BflimSimd::getLevel()) << "\", ";
+        out << "\"threads\": " << std::thread::hardware_concurrency() << ", ";
+        out << "\"minTimeMs\": " << options.minTimeMs << ", ";
+        out << "\"repeats\": " << options.repeats << "},\n  \"results\": [\n";
+
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "    {\"format\": %u, \"formatName\": \"%s\", \"tileMode\": %u, \"width\": %u, \"height\": %u, "
+                          "\"stage\": \"%s\", \"iterations\": %llu, \"bytes\": %zu, \"nsPerIteration\": %.1f, "
+                          "\"mbPerSecond\": %.3f, \"nsPerPixel\": %.4f}%s\n",
+                          r.formatId, jsonEscape(r.formatName).c_str(), r.tileMode, r.width, r.height,
+                          r.stage.c_str(), (unsigned long long)r.iterations, r.bytes, r.nsPerIteration,
+                          r.bytes / r.nsPerIteration * 1e3, r.nsPerIteration / ((double)r.width * r.height),
+                          i + 1 < results.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n}\n";
+    }
+
+    void writeCsv(std::ostream& out, const std::vector<Result>& results)
+    {
+        out << "format,formatName,tileMode,width,height,stage,iterations,bytes,nsPerIteration,mbPerSecond,nsPerPixel\n";
+        for (const Result& r : results) {
+            char line[512];
+            std::snprintf(line, sizeof(line), "%u,%s,%u,%u,%u,%s,%llu,%zu,%.1f,%.3f,%.4f\n",
+                          r.formatId, r.formatName.c_str(), r.tileMode, r.width, r.height, r.stage.c_str(),
+                          (unsigned long long)r.iterations, r.bytes, r.nsPerIteration,
+                          r.bytes / r.nsPerIteration * 1e3, r.nsPerIteration / ((double)r.width * r.height));
+            out << line;
+        }
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return false;
+
+            const char* value = argv[++i];
+            if (arg == "--json") options.jsonPath = value;
+            else if (arg == "--csv") options.csvPath = value;
+            else if (arg == "--min-time") options.minTimeMs = std::atof(value);
+            else if (arg == "--repeats") options.repeats = std::max(1, std::atoi(value));
+            else if (arg == "--min-size") options.minSize = (u32)std::max(1, std::atoi(value));
+            else if (arg == "--max-size") options.maxSize = (u32)std::atoi(value);
+            else if (arg == "--format") options.formatFilter = (int)std::strtol(value, nullptr, 0);
+            else if (arg == "--tile-mode") options.tileModeFilter = std::atoi(value);
+            else return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: BflimBench [--json file] [--csv file] [--min-time ms] [--repeats n]\n"
+                             "                  [--min-size n] [--max-size n] [--format id] [--tile-mode n]\n");
+        return 1;
+    }
+
+    const u8 tileModes[] = { 0, 1, 2, 4 };
+    std::vector<Result> results;
+
+    for (const Format& format : BflimConstants::SupportedFormats) {
+        if (options.formatFilter >= 0 && format.mId != options.formatFilter) continue;
+        // 3DS-only formats have no GX2 layout
+        if (format.mGX2Format == GX2_SURFACE_FORMAT_INVALID) continue;
+
+        for (u8 tileMode : tileModes) {
+            if (options.tileModeFilter >= 0 && tileMode != options.tileModeFilter) continue;
+
+            for (u32 size = options.minSize; size <= options.maxSize; size *= 2) {
+                benchTexture(options, format, tileMode, size, results);
+            }
+        }
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream json(options.jsonPath);
+        writeJson(json, options, results);
+    }
+    else {
+        writeJson(std::cout, options, results);
+    }
+
+    if (!options.csvPath.empty()) {
+        std::ofstream csv(options.csvPath);
+        writeCsv(csv, results);
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+// Converts BFLIM files to 32-bit TGA images using BflimBatch.
+//
+//   BflimConvert [-j threads] [-o outputDir] [-t trace.json] file.bflim...
+//   BflimConvert -i file.bflim...    (only print the metadata, reads just the file footers)
+//   BflimConvert -f dds|ktx [-o outputDir] file.bflim...    (stored texels/blocks, not decoded)
+//
+// Prints one line per file and exits with 1 if any conversion failed. -t writes a
+// Chrome trace of the conversion and prints the time spent per pipeline stage.
+
+#include <Bflim.h>
+#include <BflimBatch.h>
+#include <BflimExporter.h>
+#include <BflimProfiler.h>
+#include <BflimView.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    bool writeTGA(const std::string& path, const BflimBatchResult& result)
+    {
+        u8 header[18] = {};
+        header[2] = 2; // uncompressed true color
+        header[12] = result.width & 0xFF;
+        header[13] = result.width >> 8;
+        header[14] = result.height & 0xFF;
+        header[15] = result.height >> 8;
+        header[16] = 32;
+        header[17] = 0x28; // top-left origin, 8 alpha bits
+
+        std::vector<u8> bgra(result.rgba.size());
+        for (size_t i = 0; i < result.rgba.size(); i += 4) {
+            bgra[i + 0] = result.rgba[i + 2];
+            bgra[i + 1] = result.rgba[i + 1];
+            bgra[i + 2] = result.rgba[i + 0];
+            bgra[i + 3] = result.rgba[i + 3];
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(bgra.data()), bgra.size());
+        return file.good();
+    }
+
+    int printInfo(const std::vector<BflimBatchInput>& inputs)
+    {
+        u32 failed = 0;
+        for (const BflimBatchInput& input : inputs) {
+            BflimInfo info;
+            if (!BflimView::probeFile(input.path, info)) {
+                std::printf("FAIL  %s: Not a BFLIM file\n", input.path.c_str());
+                failed++;
+                continue;
+            }
+
+            std::printf("%-5s %s (%ux%u, format 0x%02X %s, tile mode %u, swizzle %u)\n",
+                        info.platform == BflimPlatform::CTR ? "3DS" : "WiiU", input.path.c_str(), info.width,
+                        info.height, info.formatId, info.format ? info.format->mName : "unknown", info.tileMode,
+                        info.swizzle);
+        }
+        return failed ? 1 : 0;
+    }
+
+    std::filesystem::path getOutputPath(const std::string& input, const std::string& outputDir, const char* extension)
+    {
+        std::filesystem::path output = input;
+        output.replace_extension(extension);
+        if (!outputDir.empty()) output = std::filesystem::path(outputDir) / output.filename();
+        return output;
+    }
+
+    int exportFiles(const std::vector<BflimBatchInput>& inputs, BflimContainer container, const std::string& outputDir)
+    {
+        u32 failed = 0;
+        for (const BflimBatchInput& input : inputs) {
+            BflimMappedFile file;
+            BflimView view;
+            std::string error;
+            std::vector<u8> output;
+
+            if (!file.open(input.path) || !view.parse(file.data(), file.size())) {
+                error = "Not a BFLIM file";
+            }
+            else {
+                Bflim bflim;
+                bflim.parseImageInformation(view);
+                output = BflimExporter::exportTexture(bflim, view.getImageData(), view.getImageDataSize(), container, error);
+            }
+
+            std::filesystem::path path = getOutputPath(input.path, outputDir, BflimExporter::getExtension(container));
+            if (!output.empty()) {
+                std::ofstream stream(path, std::ios::binary);
+                stream.write(reinterpret_cast<const char*>(output.data()), output.size());
+                if (!stream.good()) error = "Cannot write " + path.string();
+            }
+
+            if (error.empty()) {
+                std::printf("OK    %s -> %s\n", input.path.c_str(), path.string().c_str());
+            }
+            else {
+                std::printf("FAIL  %s: %s\n", input.path.c_str(), error.c_str());
+                failed++;
+            }
+        }
+
+        std::printf("%zu exported, %u failed\n", inputs.size() - failed, failed);
+        return failed ? 1 : 0;
+    }
+
+    void printStageStats()
+    {
+        BflimProfiler::Stats stats = BflimProfiler::getStats();
+        for (size_t i = 0; i < (size_t)BflimProfiler::Stage::Count; i++) {
+            const BflimProfiler::StageStats& stage = stats.stages[i];
+            if (stage.calls == 0) continue;
+
+            std::printf("%-14s %8llu calls %10.3f ms %10.1f MB %8llu allocations\n",
+                        BflimProfiler::getStageName((BflimProfiler::Stage)i), (unsigned long long)stage.calls,
+                        stage.nanoseconds / 1e6, stage.bytes / (1024.0 * 1024.0), (unsigned long long)stage.allocations);
+        }
+    }
+
+    void printUsage()
+    {
+        std::fprintf(stderr, "Usage: BflimConvert [-j threads] [-o outputDir] [-t trace.json] file.bflim...\n"
+                             "       BflimConvert -i file.bflim...\n"
+                             "       BflimConvert -f dds|ktx [-o outputDir] file.bflim...\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    u32 threads = 0;
+    bool infoOnly = false;
+    std::string exportFormat;
+    std::string outputDir;
+    std::string tracePath;
+    std::vector<BflimBatchInput> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = (u32)std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            exportFormat = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-i") == 0) {
+            infoOnly = true;
+        }
+        else {
+            inputs.push_back(BflimBatchInput::fromFile(argv[i]));
+        }
+    }
+
+    if (inputs.empty() || (!exportFormat.empty() && exportFormat != "dds" && exportFormat != "ktx")) {
+        printUsage();
+        return 1;
+    }
+
+    if (infoOnly) {
+        return printInfo(inputs);
+    }
+
+    if (!outputDir.empty()) {
+        std::filesystem::create_directories(outputDir);
+    }
+
+    if (!exportFormat.empty()) {
+        return exportFiles(inputs, exportFormat == "ktx" ? BflimContainer::KTX : BflimContainer::DDS, outputDir);
+    }
+
+    if (!tracePath.empty()) {
+        BflimProfiler::startTrace();
+    }
+
+    std::atomic<u32> writeFailures(0);
+    BflimBatch batch(threads);
+    std::vector<BflimBatchResult> results = batch.run(inputs, [&](size_t index, BflimBatchResult& result) {
+        if (!result.success) return;
+
+        std::filesystem::path output = getOutputPath(inputs[index].path, outputDir, ".tga");
+
+        if (!writeTGA(output.string(), result)) {
+            result.success = false;
+            result.error = "Cannot write " + output.string();
+            writeFailures++;
+        }
+    });
+
+    u32 failed = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BflimBatchResult& result = results[i];
+        if (result.success) {
+            std::printf("OK    %s (%ux%u, format 0x%02X, tile mode %u)\n", inputs[i].path.c_str(),
+                        result.width, result.height, result.formatId, result.tileMode);
+        }
+        else {
+            std::printf("FAIL  %s: %s\n", inputs[i].path.c_str(), result.error.c_str());
+            failed++;
+        }
+    }
+
+    std::printf("%zu converted, %u failed\n", results.size() - failed, failed);
+
+    if (!tracePath.empty()) {
+        BflimProfiler::stopTrace();
+        printStageStats();
+        if (!BflimProfiler::writeTrace(tracePath)) failed++;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+// Checks that GX2TileMap is byte-identical to GX2CopySurface (ninTexUtils).
+//
+//   BflimTilingCheck [-v]
+//
+// Covers tile modes 1-15, one surface format per element size (8 to 128 bits, BCn
+// blocks included), odd sizes and every pipe/bank swizzle. For each surface the
+// pitch, image size and alignment must match GX2CalcSurfaceSizeAndAlignment, and
+// deswizzle/swizzle must produce the same bytes as GX2CopySurface to and from a
+// LINEAR_SPECIAL surface. -v prints every case. Exits with 1 if any case differs.
+
+#include <BflimTiling.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct TestFormat
+    {
+        u32 format;
+        const char* name;
+    };
+
+    // One format per element size, as raw hardware format values
+    constexpr TestFormat TestFormats[] = {
+        { 0x001, "R8 (8 bpp)" },
+        { 0x008, "RGB565 (16 bpp)" },
+        { 0x01A, "RGBA8 (32 bpp)" },
+        { 0x01F, "RGBA16 (64 bpp)" },
+        { 0x022, "RGBA32 (128 bpp)" },
+        { 0x031, "BC1 (64-bit blocks)" },
+        { 0x033, "BC3 (128-bit blocks)" },
+    };
+
+    struct TestSize
+    {
+        u32 width;
+        u32 height;
+    };
+
+    constexpr TestSize TestSizes[] = {
+        { 1, 1 }, { 7, 5 }, { 33, 17 }, { 100, 37 }, { 129, 65 }, { 257, 130 }, { 64, 512 },
+    };
+
+    // Deterministic contents, so a failing case can be reproduced
+    void fill(std::vector<u8>& buffer, u32 seed)
+    {
+        u32 state = seed * 2654435761u + 1;
+        for (u8& byte : buffer) {
+            state = state * 1664525u + 1013904223u;
+            byte = (u8)(state >> 24);
+        }
+    }
+
+    GX2Surface makeSurface(u32 width, u32 height, u32 format, u32 tileMode, u32 swizzle)
+    {
+        GX2Surface surface;
+        std::memset(&surface, 0, sizeof(GX2Surface));
+        surface.dim = GX2_SURFACE_DIM_2D;
+        surface.width = width;
+        surface.height = height;
+        surface.depth = 1;
+        surface.numMips = 1;
+        surface.format = (GX2SurfaceFormat)format;
+        surface.aa = GX2_AA_MODE_1X;
+        surface.use = GX2_SURFACE_USE_TEXTURE;
+        surface.tileMode = (GX2TileMode)tileMode;
+        surface.swizzle = swizzle;
+        return surface;
+    }
+
+    // Empty if the case matches
+    std::string checkSurface(u32 width, u32 height, const TestFormat& format, u32 tileMode, u32 swizzle, u32 seed)
+    {
+        GX2Surface tiledSurf = makeSurface(width, height, format.format, tileMode, swizzle);
+        // Built from the uncalculated surface, like in Bflim
+        std::shared_ptr<const GX2TileMap> tileMap = GX2TileMap::get(tiledSurf);
+
+        GX2Surface linearSurf = makeSurface(width, height, format.format, GX2_TILE_MODE_LINEAR_SPECIAL, 0);
+        GX2CalcSurfaceSizeAndAlignment(&tiledSurf);
+        GX2CalcSurfaceSizeAndAlignment(&linearSurf);
+
+        if (tileMap->getPitch() != tiledSurf.pitch) {
+            return "pitch " + std::to_string(tileMap->getPitch()) + " != " + std::to_string(tiledSurf.pitch);
+        }
+        if (tileMap->getImageSize() != tiledSurf.imageSize) {
+            return "image size " + std::to_string(tileMap->getImageSize()) + " != " + std::to_string(tiledSurf.imageSize);
+        }
+        if (tileMap->getAlignment() != tiledSurf.alignment) {
+            return "alignment " + std::to_string(tileMap->getAlignment()) + " != " + std::to_string(tiledSurf.alignment);
+        }
+
+        const u32 bytesPerElement = tileMap->getBytesPerElement();
+        const size_t rowBytes = (size_t)tileMap->getWidth() * bytesPerElement;
+        const size_t linearPitch = (size_t)linearSurf.pitch * bytesPerElement;
+
+        // Deswizzle: random tiled surface -> packed elements
+        std::vector<u8> tiled(tiledSurf.imageSize);
+        fill(tiled, seed);
+        std::vector<u8> reference(linearSurf.imageSize);
+        tiledSurf.imagePtr.set(tiled.data());
+        tiledSurf.mipPtr.set(nullptr);
+        linearSurf.imagePtr.set(reference.data());
+        linearSurf.mipPtr.set(nullptr);
+        GX2CopySurface(&tiledSurf, 0, 0, &linearSurf, 0, 0);
+
+        std::vector<u8> packed(tileMap->getLinearSize());
+        tileMap->deswizzle(tiled.data(), packed.data());
+        for (u32 y = 0; y < tileMap->getHeight(); y++) {
+            if (std::memcmp(&packed[y * rowBytes], &reference[y * linearPitch], rowBytes) != 0) {
+                return "deswizzle differs in element row " + std::to_string(y);
+            }
+        }
+
+        // Swizzle: random packed elements -> tiled surface, untouched bytes stay zero in both
+        fill(packed, seed + 1);
+        std::fill(reference.begin(), reference.end(), 0);
+        for (u32 y = 0; y < tileMap->getHeight(); y++) {
+            std::memcpy(&reference[y * linearPitch], &packed[y * rowBytes], rowBytes);
+        }
+        std::vector<u8> expected(tiledSurf.imageSize, 0);
+        tiledSurf.imagePtr.set(expected.data());
+        GX2CopySurface(&linearSurf, 0, 0, &tiledSurf, 0, 0);
+
+        std::fill(tiled.begin(), tiled.end(), 0);
+        tileMap->swizzle(packed.data(), tiled.data());
+        for (size_t i = 0; i < tiled.size(); i++) {
+            if (tiled[i] != expected[i]) {
+                return "swizzle differs at byte " + std::to_string(i);
+            }
+        }
+        return std::string();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const bool verbose = argc > 1 && std::strcmp(argv[1], "-v") == 0;
+
+    u32 cases = 0;
+    u32 failed = 0;
+    for (u32 tileMode = 1; tileMode <= 15; tileMode++) {
+        for (const TestFormat& format : TestFormats) {
+            for (const TestSize& size : TestSizes) {
+                // Pipe swizzle in bit 8, bank swizzle in bits 9-10
+                for (u32 swizzle = 0; swizzle < 8; swizzle++) {
+                    std::string error = checkSurface(size.width, size.height, format, tileMode, swizzle << 8, cases);
+                    cases++;
+
+                    if (!error.empty()) {
+                        failed++;
+                        std::printf("FAIL  tile mode %2u, %-20s %4ux%-4u swizzle %u: %s\n", tileMode, format.name,
+                                    size.width, size.height, swizzle, error.c_str());
+                    }
+                    else if (verbose) {
+                        std::printf("OK    tile mode %2u, %-20s %4ux%-4u swizzle %u\n", tileMode, format.name,
+                                    size.width, size.height, swizzle);
+                    }
+                }
+            }
+        }
+    }
+
+    std::printf("%u cases, %u failed\n", cases, failed);
+    return failed ? 1 : 0;
+}